@@ -0,0 +1,64 @@
+/*******************************************************************
+   Micro-benchmarks of the protocol hot paths in the device
+   (no sensor needed). The output can be saved in a file and
+   compared with a previous one: s8_bench -c old.txt -i new.txt
+ *******************************************************************/
+
+#include <Arduino.h>
+#include "s8_uart.h"
+#include "s8_bench.h"
+
+
+/* BEGIN CONFIGURATION */
+#define DEBUG_BAUDRATE 115200
+/* END CONFIGURATION */
+
+
+#if defined(ARDUINO_ARCH_RP2040)
+  REDIRECT_STDOUT_TO(Serial)    // to use printf (Serial.printf not supported)
+#endif
+
+
+void setup() {
+
+  // Configure serial port, we need it for debug
+  Serial.begin(DEBUG_BAUDRATE);
+
+  // Wait port is open or timeout
+  int i = 0;
+  while (!Serial && i < 50) {
+    delay(10);
+    i++;
+  }
+
+  // First message, we are alive
+  Serial.println("");
+  Serial.println("Init");
+  Serial.println("Running benchmarks...");
+  Serial.flush();
+
+  S8_bench bench;
+  S8_bench_result results[S8_BENCH_CASES];
+  uint8_t count = bench.run(results, S8_BENCH_CASES);
+
+  // Results (name ns_per_op), cycles as comment if the board has a cycle counter
+  for (uint8_t i = 0; i < count; i++) {
+    Serial.print(results[i].name);
+    Serial.print(" ");
+    Serial.print(results[i].ns_per_op, 1);
+  #ifdef S8_BENCH_CYCLES
+    Serial.print("    # cycles: ");
+    Serial.print(results[i].cycles_per_op, 1);
+  #endif
+    Serial.println("");
+  }
+
+  Serial.println("Done!");
+  Serial.flush();
+}
+
+
+void loop() {
+
+  delay(10);
+}
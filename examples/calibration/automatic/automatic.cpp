@@ -56,12 +56,12 @@ void setup() {
   sensor_S8 = new S8_UART(S8_serial);
 
   // Check if S8 is available
-  sensor_S8->get_firmware_version(sensor.firm_version);
-  int len = strlen(sensor.firm_version);
-  if (len == 0) {
-    Serial.println("SenseAir S8 CO2 sensor not found!");
+  uint8_t presence = sensor_S8->probe();
+  if (presence != S8_PROBE_FOUND) {
+    Serial.println(presence == S8_PROBE_NOISE ? "SenseAir S8 CO2 sensor not found! (noise in the line, check wiring)" : "SenseAir S8 CO2 sensor not found!");
     while (1) { delay(1); };
   }
+  sensor_S8->get_firmware_version(sensor.firm_version);
 
   // Show basic S8 sensor info
   Serial.println(">>> SenseAir S8 NDIR CO2 sensor <<<");
@@ -71,13 +71,15 @@ void setup() {
 
   // Setting ABC period
   Serial.println("Setting ABC period set to 180 hours...");
-  sensor_S8->set_ABC_period(180);
-  delay(1000);
-  sensor.abc_period = sensor_S8->get_ABC_period();
-  if (sensor.abc_period == 180) {
-    Serial.println("ABC period set succesfully");
-  } else {
-    Serial.println("Error: ABC period doesn't set!");
+  switch (sensor_S8->apply_ABC_period(180)) {
+    case S8_CONFIG_WRITTEN:
+      Serial.println("ABC period set succesfully");
+      break;
+    case S8_CONFIG_UNCHANGED:
+      Serial.println("ABC period was already set");
+      break;
+    default:
+      Serial.println("Error: ABC period doesn't set!");
   }
   
   Serial.println("Setup done!");
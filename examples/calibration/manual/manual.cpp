@@ -4,6 +4,7 @@
 
 #include <Arduino.h>
 #include "s8_uart.h"
+#include "s8_calibration.h"
 
 
 /* BEGIN CONFIGURATION */
@@ -33,7 +34,28 @@
 
 
 S8_UART *sensor_S8;
+S8_calibration *calibration;
 S8_sensor sensor;
+unsigned long calibration_start;
+
+
+/* Progress of calibration */
+void calibration_progress(uint8_t state, uint8_t progress) {
+  switch (state) {
+    case S8_CALIBRATION_STABILITY:
+      printf("Waiting stable CO2 value... %u%%\n", progress);
+      break;
+    case S8_CALIBRATION_WAIT_ACK:
+      Serial.println("Doing manual calibration...");
+      break;
+    case S8_CALIBRATION_DONE:
+      printf("Manual calibration is finished. Elapsed: %lu seconds\n", (millis() - calibration_start) / 1000);
+      break;
+    case S8_CALIBRATION_FAILED:
+      Serial.println("Error doing manual calibration!");
+      break;
+  }
+}
 
 
 void setup() {
@@ -57,12 +79,12 @@ void setup() {
   sensor_S8 = new S8_UART(S8_serial);
 
   // Check if S8 is available
-  sensor_S8->get_firmware_version(sensor.firm_version);
-  int len = strlen(sensor.firm_version);
-  if (len == 0) {
-      Serial.println("SenseAir S8 CO2 sensor not found!");
+  uint8_t presence = sensor_S8->probe();
+  if (presence != S8_PROBE_FOUND) {
+      Serial.println(presence == S8_PROBE_NOISE ? "SenseAir S8 CO2 sensor not found! (noise in the line, check wiring)" : "SenseAir S8 CO2 sensor not found!");
       while (1) { delay(1); };
   }
+  sensor_S8->get_firmware_version(sensor.firm_version);
 
   // Show basic S8 sensor info
   Serial.println(">>> SenseAir S8 NDIR CO2 sensor <<<");
@@ -81,33 +103,20 @@ void setup() {
   }
   Serial.println("Time reamining: 0 minutes 0 seconds");
 
-  // Start manual calibration
+  // Start manual calibration (it doesn't block, see loop)
   Serial.println("Starting manual calibration...");
-  if (!sensor_S8->manual_calibration()) {
-    Serial.println("Error setting manual calibration!");
-    while (1) { delay(10); }
-  }
+  calibration = new S8_calibration(*sensor_S8);
+  calibration->on_progress(calibration_progress);
+  calibration->set_stability(5, 20, 120000);     // 5 readings within 20 ppm (wait 2 minutes max.)
+  calibration_start = millis();
+  calibration->start();
 
-  
 }
 
 
 void loop() {
 
-  static unsigned int elapsed = 0;
-
-  // Wait 2 sec lamp cycle
-  delay(2000);   
-  elapsed += 2;
-
-  // Check if background calibration is finished
-  sensor.ack = sensor_S8->get_acknowledgement();
-  if (sensor.ack & S8_MASK_CO2_BACKGROUND_CALIBRATION) {
-    printf("Manual calibration is finished. Elapsed: %u seconds\n", elapsed);
-    while (1) { delay(10); }
-  } else {
-    Serial.println("Doing manual calibration...");
-  }
-
+  // Other tasks can be done here while the calibration is running
+  calibration->tick();
 
 }
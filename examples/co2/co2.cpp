@@ -55,12 +55,12 @@ void setup() {
   sensor_S8 = new S8_UART(S8_serial);
 
   // Check if S8 is available
-  sensor_S8->get_firmware_version(sensor.firm_version);
-  int len = strlen(sensor.firm_version);
-  if (len == 0) {
-      Serial.println("SenseAir S8 CO2 sensor not found!");
+  uint8_t presence = sensor_S8->probe();
+  if (presence != S8_PROBE_FOUND) {
+      Serial.println(presence == S8_PROBE_NOISE ? "SenseAir S8 CO2 sensor not found! (noise in the line, check wiring)" : "SenseAir S8 CO2 sensor not found!");
       while (1) { delay(1); };
   }
+  sensor_S8->get_firmware_version(sensor.firm_version);
 
   // Show basic S8 sensor info
   Serial.println(">>> SenseAir S8 NDIR CO2 sensor <<<");
@@ -32,6 +32,7 @@
 
 S8_UART *sensor_S8;
 S8_sensor sensor;
+S8_dump dump;
 
 
 void setup() {
@@ -55,12 +56,12 @@ void setup() {
   sensor_S8 = new S8_UART(S8_serial);
 
   // Check if S8 is available
-  sensor_S8->get_firmware_version(sensor.firm_version);
-  int len = strlen(sensor.firm_version);
-  if (len == 0) {
-      Serial.println("SenseAir S8 CO2 sensor not found!");
+  uint8_t presence = sensor_S8->probe();
+  if (presence != S8_PROBE_FOUND) {
+      Serial.println(presence == S8_PROBE_NOISE ? "SenseAir S8 CO2 sensor not found! (noise in the line, check wiring)" : "SenseAir S8 CO2 sensor not found!");
       while (1) { delay(1); };
   }
+  sensor_S8->get_firmware_version(sensor.firm_version);
 
   // Show basic S8 sensor info
   Serial.println(">>> SenseAir S8 NDIR CO2 sensor <<<");
@@ -68,9 +69,15 @@ void setup() {
   sensor.sensor_id = sensor_S8->get_sensor_ID();
   Serial.print("Sensor ID: 0x"); printIntToHex(sensor.sensor_id, 4); Serial.println("");
 
-  // Check the health of the sensor
+  // Check the health of the sensor, snapshot of all registers
   Serial.println("Checking the health of the sensor...");
-  sensor.meter_status = sensor_S8->get_meter_status();
+  if (sensor_S8->dump(dump) != S8_DUMP_ALL) {
+    Serial.println("Error reading some registers of the sensor!");
+  }
+  printf("IR1-IR4: %04X %04X %04X %d ppm, IR22: %d (%ld ppm)\n", (uint16_t)dump.meter_status, (uint16_t)dump.alarm_status,
+         (uint16_t)dump.output_status, dump.co2, dump.pwm_output, (long)S8_reg_pwm_output::scale(dump.pwm_output));
+  printf("HR1: %04X, HR2: %04X, HR32: %d hours\n", (uint16_t)dump.ack, (uint16_t)dump.special_command, dump.abc_period);
+  sensor.meter_status = dump.meter_status;
   
   if (sensor.meter_status & S8_MASK_METER_ANY_ERROR) {
     Serial.println("One or more errors detected!");
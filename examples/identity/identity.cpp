@@ -0,0 +1,93 @@
+/**************************************************************
+   Read identity of the sensor only at first boot, next boots
+   load it from NVS (ESP32) or EEPROM with one transaction
+ **************************************************************/
+
+#include <Arduino.h>
+#include "s8_uart.h"
+#include "s8_identity.h"
+
+
+/* BEGIN CONFIGURATION */
+#define DEBUG_BAUDRATE 115200
+
+#if (defined USE_SOFTWARE_SERIAL || defined ARDUINO_ARCH_RP2040)
+  #define S8_RX_PIN 5         // Rx pin which the S8 Tx pin is attached to (change if it is needed)
+  #define S8_TX_PIN 4         // Tx pin which the S8 Rx pin is attached to (change if it is needed)
+#else
+  #define S8_UART_PORT  1     // Change UART port if it is needed
+#endif
+/* END CONFIGURATION */
+
+
+#ifdef USE_SOFTWARE_SERIAL
+  SoftwareSerial S8_serial(S8_RX_PIN, S8_TX_PIN);
+#else
+  #if defined(ARDUINO_ARCH_RP2040)
+    REDIRECT_STDOUT_TO(Serial)    // to use printf (Serial.printf not supported)
+    UART S8_serial(S8_TX_PIN, S8_RX_PIN, NC, NC);
+  #else
+    HardwareSerial S8_serial(S8_UART_PORT);   
+  #endif
+#endif
+
+
+S8_UART *sensor_S8;
+S8_sensor sensor;
+
+#ifdef ARDUINO_ARCH_ESP32
+  S8_nvs_storage storage;
+#else
+  S8_eeprom_storage storage(0);   // EEPROM address
+#endif
+
+
+void setup() {
+
+  // Configure serial port, we need it for debug
+  Serial.begin(DEBUG_BAUDRATE);
+
+  // Wait port is open or timeout
+  int i = 0;
+  while (!Serial && i < 50) {
+    delay(10);
+    i++;
+  }
+  
+  // First message, we are alive
+  Serial.println("");
+  Serial.println("Init");
+
+  // Initialize S8 sensor
+  S8_serial.begin(S8_BAUDRATE);
+  sensor_S8 = new S8_UART(S8_serial);
+
+  // Identity of the sensor (saved identity is used if sensor ID is the same)
+  S8_identity_store identity(*sensor_S8, storage);
+  if (!identity.begin(sensor)) {
+      Serial.println("SenseAir S8 CO2 sensor not found!");
+      while (1) { delay(1); };
+  }
+
+  Serial.println(">>> SenseAir S8 NDIR CO2 sensor <<<");
+  printf("Identity %s (%d transactions)\n", identity.loaded ? "loaded" : "read and saved", identity.transactions);
+  printf("Firmware version: %s\n", sensor.firm_version);
+  Serial.print("Sensor type: 0x"); printIntToHex(sensor.sensor_type_id, 3); Serial.println("");
+  Serial.print("Sensor ID: 0x"); printIntToHex(sensor.sensor_id, 4); Serial.println("");
+  printf("Memory map version: %d\n", sensor.map_version);
+  printf("ABC period: %d hours\n", sensor.abc_period);
+
+  Serial.println("Setup done!");
+  Serial.flush();
+}
+
+
+void loop() {
+
+  // Get CO2 measure
+  sensor.co2 = sensor_S8->get_co2();
+  printf("CO2 value = %d ppm\n", sensor.co2);
+
+  // Wait 5 second for next measure
+  delay(5000);
+}
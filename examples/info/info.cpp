@@ -31,7 +31,7 @@
 
 
 S8_UART *sensor_S8;
-S8_sensor sensor;
+S8_dump dump;
 
 
 void setup() {
@@ -55,36 +55,40 @@ void setup() {
   sensor_S8 = new S8_UART(S8_serial);
 
   // Check if S8 is available
-  sensor_S8->get_firmware_version(sensor.firm_version);
-  int len = strlen(sensor.firm_version);
-  if (len == 0) {
-      Serial.println("SenseAir S8 CO2 sensor not found!");
+  uint8_t presence = sensor_S8->probe();
+  if (presence != S8_PROBE_FOUND) {
+      Serial.println(presence == S8_PROBE_NOISE ? "SenseAir S8 CO2 sensor not found! (noise in the line, check wiring)" : "SenseAir S8 CO2 sensor not found!");
       while (1) { delay(1); };
   }
 
+  // Read all registers of the sensor at once (a few transactions)
+  if (sensor_S8->dump(dump) != S8_DUMP_ALL) {
+    Serial.println("Error reading some registers of the sensor!");
+  }
+
   // Show S8 sensor info
   Serial.println(">>> SenseAir S8 NDIR CO2 sensor <<<");
 
-  Serial.print("Firmware version: "); Serial.println(sensor.firm_version);
-
-  sensor.sensor_type_id = sensor_S8->get_sensor_type_ID();
-  Serial.print("Sensor type: 0x"); printIntToHex(sensor.sensor_type_id, 3); Serial.println("");
-
-  sensor.sensor_id = sensor_S8->get_sensor_ID();
-  Serial.print("Sensor ID: 0x"); printIntToHex(sensor.sensor_id, 4); Serial.println("");
-
-  sensor.map_version = sensor_S8->get_memory_map_version();
-  Serial.print("Memory map version: "); Serial.println(sensor.map_version);
+  Serial.print("Firmware version: "); Serial.println(dump.firm_version);
+  Serial.print("Sensor type: 0x"); printIntToHex(dump.sensor_type_id, 3); Serial.println("");
+  Serial.print("Sensor ID: 0x"); printIntToHex(dump.sensor_id, 4); Serial.println("");
+  Serial.print("Memory map version: "); Serial.println(dump.map_version);
 
-  sensor.abc_period = sensor_S8->get_ABC_period();
-  
-  if (sensor.abc_period > 0) {
+  if (dump.abc_period > 0) {
     Serial.print("ABC (automatic background calibration) period: ");
-    Serial.print(sensor.abc_period); Serial.println(" hours");
+    Serial.print(dump.abc_period); Serial.println(" hours");
   } else {
     Serial.println("ABC (automatic calibration) is disabled");
   }
-  
+
+  Serial.print("CO2: "); Serial.print(dump.co2); Serial.println(" ppm");
+  Serial.print("PWM output: "); Serial.print(S8_reg_pwm_output::scale(dump.pwm_output)); Serial.println(" ppm");
+  Serial.print("Meter status: 0x"); printIntToHex(dump.meter_status, 2); Serial.println("");
+  Serial.print("Alarm status: 0x"); printIntToHex(dump.alarm_status, 2); Serial.println("");
+  Serial.print("Output status: 0x"); printIntToHex(dump.output_status, 2); Serial.println("");
+  Serial.print("Acknowledgement flags: 0x"); printIntToHex(dump.ack, 2); Serial.println("");
+  Serial.print("Read in "); Serial.print(dump.transactions); Serial.println(" transactions");
+
 }
 
 
@@ -0,0 +1,93 @@
+/****************************************************************
+   Sensor I/O in one core (ESP32 task or RP2040 core 1), the
+   application takes timestamped samples without waiting UART
+ ****************************************************************/
+
+#include <Arduino.h>
+#include "s8_uart.h"
+#include "s8_runner.h"
+
+
+#if !defined(ARDUINO_ARCH_ESP32) && !defined(ARDUINO_ARCH_RP2040)
+  #error "This example needs a dual core board (ESP32 or RP2040)"
+#endif
+
+
+/* BEGIN CONFIGURATION */
+#define DEBUG_BAUDRATE 115200
+
+#if (defined USE_SOFTWARE_SERIAL || defined ARDUINO_ARCH_RP2040)
+  #define S8_RX_PIN 5         // Rx pin which the S8 Tx pin is attached to (change if it is needed)
+  #define S8_TX_PIN 4         // Tx pin which the S8 Rx pin is attached to (change if it is needed)
+#else
+  #define S8_UART_PORT  1     // Change UART port if it is needed
+#endif
+/* END CONFIGURATION */
+
+
+#ifdef USE_SOFTWARE_SERIAL
+  SoftwareSerial S8_serial(S8_RX_PIN, S8_TX_PIN);
+#else
+  #if defined(ARDUINO_ARCH_RP2040)
+    REDIRECT_STDOUT_TO(Serial)    // to use printf (Serial.printf not supported)
+    UART S8_serial(S8_TX_PIN, S8_RX_PIN, NC, NC);
+  #else
+    HardwareSerial S8_serial(S8_UART_PORT);   
+  #endif
+#endif
+
+
+S8_UART *sensor_S8;
+S8_runner runner;
+
+
+void setup() {
+
+  // Configure serial port, we need it for debug
+  Serial.begin(DEBUG_BAUDRATE);
+
+  // Wait port is open or timeout
+  int i = 0;
+  while (!Serial && i < 50) {
+    delay(10);
+    i++;
+  }
+  
+  // First message, we are alive
+  Serial.println("");
+  Serial.println("Init");
+
+  // Initialize S8 sensor
+  S8_serial.begin(S8_BAUDRATE);
+  sensor_S8 = new S8_UART(S8_serial);
+
+  // From now, sensor_S8 is only used by the runner
+  runner.add(*sensor_S8);
+#ifdef ARDUINO_ARCH_ESP32
+  runner.begin(2000, 0);    // Every 2 seconds in core 0 (Arduino loop runs in core 1)
+#else
+  runner.begin(2000);       // Every 2 seconds in core 1
+#endif
+
+  Serial.println("Setup done!");
+  Serial.flush();
+}
+
+
+void loop() {
+
+  S8_sample sample;
+
+  // It never waits for the sensor
+  while (runner.pop(sample)) {
+    if (sample.status == S8_TRANSACTION_DONE) {
+      printf("[%lu ms] Sensor %d: CO2 value = %d ppm, meter status = 0x%04X\n", (unsigned long)sample.time, sample.sensor,
+             sample.data.co2, (unsigned int)sample.data.meter_status);
+    } else {
+      printf("[%lu ms] Sensor %d: error reading the sensor!\n", (unsigned long)sample.time, sample.sensor);
+    }
+  }
+
+  // Application work here
+  delay(10);
+}
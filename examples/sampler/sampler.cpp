@@ -0,0 +1,129 @@
+/**********************************************************
+   Get CO2 value only when the sensor has a new measure
+ **********************************************************/
+
+#include <Arduino.h>
+#include "s8_uart.h"
+#include "s8_sampler.h"
+#include "s8_filter.h"
+#include "s8_anomaly.h"
+
+
+/* BEGIN CONFIGURATION */
+#define DEBUG_BAUDRATE 115200
+
+#if (defined USE_SOFTWARE_SERIAL || defined ARDUINO_ARCH_RP2040)
+  #define S8_RX_PIN 5         // Rx pin which the S8 Tx pin is attached to (change if it is needed)
+  #define S8_TX_PIN 4         // Tx pin which the S8 Rx pin is attached to (change if it is needed)
+#else
+  #define S8_UART_PORT  1     // Change UART port if it is needed
+#endif
+/* END CONFIGURATION */
+
+
+#ifdef USE_SOFTWARE_SERIAL
+  SoftwareSerial S8_serial(S8_RX_PIN, S8_TX_PIN);
+#else
+  #if defined(ARDUINO_ARCH_RP2040)
+    REDIRECT_STDOUT_TO(Serial)    // to use printf (Serial.printf not supported)
+    UART S8_serial(S8_TX_PIN, S8_RX_PIN, NC, NC);
+  #else
+    HardwareSerial S8_serial(S8_UART_PORT);   
+  #endif
+#endif
+
+
+S8_UART *sensor_S8;
+S8_sampler *sampler;
+S8_filter filter;     // Median of 3 and moving average (change with set_median, set_ema or set_kalman)
+S8_anomaly anomaly;   // Stuck or faulty sensor
+S8_sensor sensor;
+
+
+/* New CO2 measure */
+void new_co2(int16_t co2) {
+  sensor.co2 = co2;
+  printf("CO2 value = %d ppm (filtered %d ppm)\n", sensor.co2, filter.add(co2));
+}
+
+
+/* Meter status changed */
+void status_change(int16_t meter_status) {
+  sensor.meter_status = meter_status;
+  if (meter_status & S8_MASK_METER_ANY_ERROR) {
+    Serial.println("One or more errors detected!");
+  }
+}
+
+
+/* Anomalies changed */
+void anomaly_change(uint8_t flags) {
+  if (flags & S8_ANOMALY_FLATLINE) {
+    Serial.println("Same CO2 value for more than one hour, the sensor can be stuck!");
+  }
+  if (flags & (S8_ANOMALY_RATE | S8_ANOMALY_RANGE | S8_ANOMALY_STATUS | S8_ANOMALY_PWM)) {
+    Serial.print("Anomaly in the readings: 0x"); printIntToHex(flags, 1); Serial.println("");
+  }
+}
+
+
+/* Error reading the sensor */
+void error(uint8_t status) {
+  Serial.println("Error reading the sensor!");
+}
+
+
+void setup() {
+
+  // Configure serial port, we need it for debug
+  Serial.begin(DEBUG_BAUDRATE);
+
+  // Wait port is open or timeout
+  int i = 0;
+  while (!Serial && i < 50) {
+    delay(10);
+    i++;
+  }
+  
+  // First message, we are alive
+  Serial.println("");
+  Serial.println("Init");
+
+  // Initialize S8 sensor
+  S8_serial.begin(S8_BAUDRATE);
+  sensor_S8 = new S8_UART(S8_serial);
+
+  // Check if S8 is available
+  uint8_t presence = sensor_S8->probe();
+  if (presence != S8_PROBE_FOUND) {
+      Serial.println(presence == S8_PROBE_NOISE ? "SenseAir S8 CO2 sensor not found! (noise in the line, check wiring)" : "SenseAir S8 CO2 sensor not found!");
+      while (1) { delay(1); };
+  }
+  sensor_S8->get_firmware_version(sensor.firm_version);
+
+  // Show basic S8 sensor info
+  Serial.println(">>> SenseAir S8 NDIR CO2 sensor <<<");
+  printf("Firmware version: %s\n", sensor.firm_version);
+  sensor.sensor_id = sensor_S8->get_sensor_ID();
+  Serial.print("Sensor ID: 0x"); printIntToHex(sensor.sensor_id, 4); Serial.println("");
+
+  // Sampler aligned to the measurement cycle of the sensor, a new measure every 2 seconds
+  sampler = new S8_sampler(*sensor_S8);
+  sampler->on_co2(new_co2);
+  sampler->on_status_change(status_change);
+  sampler->on_error(error);
+  anomaly.on_change(anomaly_change);
+  sampler->set_anomaly(&anomaly);
+  //sampler->set_interval(10000);   // Only one measure every 10 seconds
+
+  Serial.println("Setup done!");
+  Serial.flush();
+}
+
+
+void loop() {
+
+  // It never blocks, other tasks can be done here
+  sampler->tick();
+
+}
@@ -0,0 +1,183 @@
+/****************************************************************************
+   Micro-benchmarks of the protocol hot paths (S8_bench) plus a full
+   transaction with an emulated sensor on a pseudo-terminal
+
+     ./build/s8_bench [-r repeats] [-s save_file] [-c baseline_file] [-t threshold_%]
+     ./build/s8_bench -c baseline_file -i results_file   (ex: results of a device)
+
+   Results files have one line per case: "name ns_per_op". With a baseline,
+   every case shows the change and it returns 1 if any case is slower than
+   the threshold (default 10%).
+ ****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "s8_uart.h"
+#include "s8_bench.h"
+#include "s8_transport_posix.h"
+#include "s8_pty_emulator.h"
+
+
+#define MAX_RESULTS  (S8_BENCH_CASES + 1)
+#define LEN_NAME     32
+
+
+struct Result {
+  char name[LEN_NAME];
+  float ns_per_op;
+};
+
+
+static S8_UART *emulated_sensor;
+
+
+/* Full transaction with the emulator (no pacing) */
+static void bench_emulated_transaction(uint32_t iterations) {
+  while (iterations--) {
+    emulated_sensor->get_co2();
+  }
+}
+
+
+/* Load results file */
+static int load(const char *file, Result results[]) {
+  FILE *f = fopen(file, "r");
+  int n = 0;
+
+  if (f == NULL) {
+    printf("Can't open %s!\n", file);
+    return -1;
+  }
+
+  // Other lines and text after the value (ex: "# cycles") are ignored
+  char line[128];
+  while (n < MAX_RESULTS && fgets(line, sizeof(line), f) != NULL) {
+    if (sscanf(line, "%31s %f", results[n].name, &results[n].ns_per_op) == 2) {
+      n++;
+    }
+  }
+
+  fclose(f);
+  return n;
+}
+
+
+int main(int argc, char *argv[]) {
+
+  const char *save_file = NULL;
+  const char *baseline_file = NULL;
+  const char *input_file = NULL;
+  float threshold = 10;
+  int repeats = S8_BENCH_REPEATS;
+
+  for (int i = 1; i + 1 < argc; i += 2) {
+    if (strcmp(argv[i], "-r") == 0) {
+      repeats = atoi(argv[i + 1]);
+    } else if (strcmp(argv[i], "-s") == 0) {
+      save_file = argv[i + 1];
+    } else if (strcmp(argv[i], "-c") == 0) {
+      baseline_file = argv[i + 1];
+    } else if (strcmp(argv[i], "-i") == 0) {
+      input_file = argv[i + 1];
+    } else if (strcmp(argv[i], "-t") == 0) {
+      threshold = atof(argv[i + 1]);
+    } else {
+      printf("Unknown option %s\n", argv[i]);
+      return 1;
+    }
+  }
+
+  Result results[MAX_RESULTS];
+  int count = 0;
+
+  if (input_file != NULL) {
+    count = load(input_file, results);
+    if (count <= 0) {
+      return 1;
+    }
+
+  } else {
+    S8_bench bench;
+    S8_bench_result bench_results[MAX_RESULTS];
+    bench.set_repeats(repeats);
+
+    count = bench.run(bench_results, S8_BENCH_CASES);
+
+    // Emulated sensor, served by a child process
+    S8_pty_emulator emulator;
+    if (emulator.begin(1)) {
+      pid_t child = fork();
+      if (child == 0) {
+        while (emulator.serve_once(100) >= 0 && getppid() != 1) {
+        }
+        _exit(0);
+      }
+
+      S8_posix_transport transport(emulator.name(0));
+      if (transport.begin()) {
+        S8_UART sensor(transport);
+        emulated_sensor = &sensor;
+        bench_results[count++] = bench.measure("pty_transaction", bench_emulated_transaction);
+      }
+
+      kill(child, SIGTERM);
+      waitpid(child, NULL, 0);
+    }
+
+    for (int i = 0; i < count; i++) {
+      snprintf(results[i].name, LEN_NAME, "%s", bench_results[i].name);
+      results[i].ns_per_op = bench_results[i].ns_per_op;
+    }
+  }
+
+  // Baseline
+  Result baseline[MAX_RESULTS];
+  int baseline_count = 0;
+  if (baseline_file != NULL) {
+    baseline_count = load(baseline_file, baseline);
+    if (baseline_count < 0) {
+      return 1;
+    }
+  }
+
+  // Report
+  int regressions = 0;
+  printf("%-20s %14s", "case", "ns/op");
+  if (baseline_count > 0) {
+    printf(" %14s %9s", "baseline", "change");
+  }
+  printf("\n");
+
+  for (int i = 0; i < count; i++) {
+    printf("%-20s %14.1f", results[i].name, results[i].ns_per_op);
+
+    for (int j = 0; j < baseline_count; j++) {
+      if (strcmp(baseline[j].name, results[i].name) == 0 && baseline[j].ns_per_op > 0) {
+        float change = (results[i].ns_per_op - baseline[j].ns_per_op) * 100 / baseline[j].ns_per_op;
+        printf(" %14.1f %+8.1f%%", baseline[j].ns_per_op, change);
+        if (change > threshold) {
+          printf("  SLOWER");
+          regressions++;
+        }
+      }
+    }
+    printf("\n");
+  }
+
+  if (save_file != NULL) {
+    FILE *f = fopen(save_file, "w");
+    if (f == NULL) {
+      printf("Can't create %s!\n", save_file);
+      return 1;
+    }
+    for (int i = 0; i < count; i++) {
+      fprintf(f, "%s %.1f\n", results[i].name, results[i].ns_per_op);
+    }
+    fclose(f);
+  }
+
+  return (regressions > 0) ? 1 : 0;
+}
@@ -0,0 +1,77 @@
+/**********************************************
+   Get CO2 value from a serial port of Linux
+ **********************************************/
+
+#include <stdio.h>
+#include "s8_uart.h"
+#include "s8_transport_posix.h"
+#include "s8_trace.h"
+
+
+static FILE *trace_file = NULL;
+
+
+/* Save trace bytes in the file */
+static void write_trace(const uint8_t *data, size_t len) {
+  fwrite(data, 1, len, trace_file);
+  fflush(trace_file);
+}
+
+
+int main(int argc, char *argv[]) {
+
+  if (argc < 2) {
+    printf("Usage: %s <serial device> [trace file]  (ex: /dev/ttyUSB0 s8.trace)\n", argv[0]);
+    return 1;
+  }
+
+  // Initialize serial port
+  S8_posix_transport transport(argv[1]);
+  if (!transport.begin()) {
+    printf("Can't open %s!\n", argv[1]);
+    return 1;
+  }
+
+  // Record traffic if a trace file is given (see s8_replay)
+  S8_capture_transport capture(transport);
+  if (argc > 2) {
+    trace_file = fopen(argv[2], "wb");
+    if (trace_file == NULL) {
+      printf("Can't create %s!\n", argv[2]);
+      return 1;
+    }
+    capture.capture_to(write_trace);
+    capture.start();
+  }
+
+  // Initialize S8 sensor
+  S8_UART sensor_S8(capture);
+  S8_sensor sensor;
+
+  // Check if S8 is available
+  uint8_t presence = sensor_S8.probe();
+  if (presence != S8_PROBE_FOUND) {
+    printf(presence == S8_PROBE_NOISE ? "SenseAir S8 CO2 sensor not found! (noise in the line)\n" : "SenseAir S8 CO2 sensor not found!\n");
+    return 1;
+  }
+  sensor_S8.get_firmware_version(sensor.firm_version);
+
+  // Show basic S8 sensor info
+  printf(">>> SenseAir S8 NDIR CO2 sensor <<<\n");
+  printf("Firmware version: %s\n", sensor.firm_version);
+  sensor.sensor_id = sensor_S8.get_sensor_ID();
+  printf("Sensor ID: 0x%08X\n", (unsigned int)sensor.sensor_id);
+
+  while (1) {
+
+    // Get CO2 measure
+    sensor.co2 = sensor_S8.get_co2();
+    printf("CO2 value = %d ppm\n", sensor.co2);
+    fflush(stdout);
+
+    // Wait 5 second for next measure
+    delay(5000);
+  }
+
+  return 0;
+}
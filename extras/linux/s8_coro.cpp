@@ -0,0 +1,84 @@
+/*************************************************************************
+   Poll many emulated sensors with coroutines from a single thread
+
+     ./build/s8_coro [sensors] [readings per sensor]
+ *************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "s8_uart.h"
+#include "s8_coro.h"
+#include "s8_transport_posix.h"
+#include "s8_pty_emulator.h"
+
+
+static uint32_t done = 0;
+static uint32_t failures = 0;
+
+
+/* Read CO2 value and meter status of a sensor sequentially */
+S8_co_task poll_sensor(S8_co_sensor &sensor, int readings) {
+  for (int i = 0; i < readings; i++) {
+    auto co2 = co_await sensor.read_co2();
+    auto status = co_await sensor.read_meter_status();
+
+    if (!co2 || !status || co2.value != 400) {
+      failures++;
+    }
+
+    co_await sensor.scheduler().sleep(10);
+  }
+  done++;
+}
+
+
+int main(int argc, char *argv[]) {
+
+  int count = (argc > 1) ? atoi(argv[1]) : 50;
+  int readings = (argc > 2) ? atoi(argv[2]) : 20;
+
+  // Emulated sensors, served by a child process
+  S8_pty_emulator emulator;
+  if (count <= 0 || !emulator.begin(count)) {
+    return 1;
+  }
+  emulator.set_pacing(S8_BAUDRATE, 2000);
+
+  pid_t child = fork();
+  if (child == 0) {
+    while (emulator.serve_once(100) >= 0 && getppid() != 1) {
+    }
+    _exit(0);
+  }
+
+  S8_co_scheduler scheduler;
+  S8_posix_transport **transports = new S8_posix_transport *[count];
+  S8_UART **sensors = new S8_UART *[count];
+  S8_co_sensor **co_sensors = new S8_co_sensor *[count];
+
+  for (int i = 0; i < count; i++) {
+    transports[i] = new S8_posix_transport(emulator.name(i));
+    transports[i]->begin();
+    sensors[i] = new S8_UART(*transports[i]);
+    co_sensors[i] = new S8_co_sensor(*sensors[i], scheduler);
+    poll_sensor(*co_sensors[i], readings);
+  }
+
+  // All transactions interleaved in this thread
+  uint32_t start = millis();
+  while (!scheduler.idle()) {
+    scheduler.run_once();
+    delay(1);
+  }
+
+  printf("Sensors: %d, readings: %d, finished: %u, failures: %u, time: %u ms\n",
+         count, readings, done, failures, millis() - start);
+
+  kill(child, SIGTERM);
+  waitpid(child, NULL, 0);
+
+  return (failures > 0) ? 1 : 0;
+}
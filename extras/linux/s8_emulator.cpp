@@ -0,0 +1,35 @@
+/********************************************************************
+   Emulated S8 sensors on pseudo-terminals (to test without sensor)
+
+   Run it and use the printed devices with the other tools:
+     ./build/s8_emulator [number of sensors] [baudrate to emulate, 0 = no pacing]
+     ./build/s8_co2 /dev/pts/N
+ ********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "s8_uart.h"
+#include "s8_pty_emulator.h"
+
+
+int main(int argc, char *argv[]) {
+
+  int count = (argc > 1) ? atoi(argv[1]) : 1;
+  int baudrate = (argc > 2) ? atoi(argv[2]) : S8_BAUDRATE;
+
+  S8_pty_emulator emulator;
+  if (count <= 0 || !emulator.begin(count)) {
+    return 1;
+  }
+  emulator.set_pacing(baudrate, 2000);
+
+  for (int i = 0; i < count; i++) {
+    printf("%s\n", emulator.name(i));
+  }
+  fflush(stdout);
+
+  while (emulator.serve_once(-1) >= 0) {
+  }
+
+  return 0;
+}
@@ -0,0 +1,90 @@
+/*************************************************************************
+   Benchmark of the epoll engine with emulated sensors on pseudo-terminals
+
+     ./build/s8_epoll_bench [sensors] [seconds] [period ms] [baudrate, 0 = no pacing]
+ *************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include "s8_uart.h"
+#include "s8_epoll.h"
+#include "s8_transport_posix.h"
+#include "s8_pty_emulator.h"
+
+
+/* CPU time of this process in microseconds */
+static uint64_t cpu_time_us() {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return (uint64_t)(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000ull + usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+}
+
+
+int main(int argc, char *argv[]) {
+
+  int count = (argc > 1) ? atoi(argv[1]) : 100;
+  int seconds = (argc > 2) ? atoi(argv[2]) : 10;
+  uint32_t period_ms = (argc > 3) ? atoi(argv[3]) : 0;
+  uint32_t baudrate = (argc > 4) ? atoi(argv[4]) : 0;
+
+  // Emulated sensors, served by a child process
+  S8_pty_emulator emulator;
+  if (count <= 0 || !emulator.begin(count)) {
+    return 1;
+  }
+  emulator.set_pacing(baudrate, 2000);
+
+  pid_t child = fork();
+  if (child == 0) {
+    while (emulator.serve_once(100) >= 0 && getppid() != 1) {
+    }
+    _exit(0);
+  }
+
+  // Sensors
+  S8_posix_transport **transports = new S8_posix_transport *[count];
+  S8_UART **sensors = new S8_UART *[count];
+  S8_epoll_engine engine;
+  engine.begin(count);
+
+  for (int i = 0; i < count; i++) {
+    transports[i] = new S8_posix_transport(emulator.name(i));
+    if (!transports[i]->begin()) {
+      printf("Can't open %s!\n", emulator.name(i));
+      kill(child, SIGTERM);
+      return 1;
+    }
+    sensors[i] = new S8_UART(*transports[i]);
+    engine.add<S8_reg_co2>(*sensors[i], transports[i]->fd(), period_ms);
+  }
+
+  // Run
+  uint64_t cpu_start = cpu_time_us();
+  uint32_t start = millis();
+  while ((millis() - start) < (uint32_t)seconds * 1000) {
+    engine.run_once(100);
+  }
+  uint32_t elapsed = millis() - start;
+  uint64_t cpu = cpu_time_us() - cpu_start;
+
+  printf("Sensors: %d, period: %u ms, baudrate: %u, time: %u ms\n", count, period_ms, baudrate, elapsed);
+  printf("Transactions: %u (%.1f/s), errors: %u, timeouts: %u\n", engine.transactions,
+         engine.transactions * 1000.0 / elapsed, engine.errors, engine.timeouts);
+  printf("CPU: %.1f us/transaction\n", engine.transactions ? (double)cpu / engine.transactions : 0.0);
+
+  kill(child, SIGTERM);
+  waitpid(child, NULL, 0);
+
+  for (int i = 0; i < count; i++) {
+    delete sensors[i];
+    delete transports[i];
+  }
+  delete[] sensors;
+  delete[] transports;
+
+  return 0;
+}
@@ -0,0 +1,146 @@
+/****************************************************************************
+   Integration and throughput harness with emulated sensors on pseudo-terminals
+
+   Every sensor is driven by its own thread through the blocking API of
+   S8_UART (serial_write_bytes, flush, serial_read_bytes), the emulator
+   answers at the baudrate of the sensor.
+
+     ./build/s8_harness [sensors] [seconds] [baudrate, 0 = no pacing] [flush, 0 = queue requests]
+
+   It returns 1 if any transaction fails.
+ ****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <algorithm>
+#include <thread>
+#include <vector>
+#include "s8_uart.h"
+#include "s8_transport_posix.h"
+#include "s8_pty_emulator.h"
+
+
+#define TURNAROUND_US  2000     // Time of the emulated sensor to answer
+
+
+struct Worker {
+  const char *device;
+  uint32_t seconds;
+  bool flush;
+  uint32_t transactions;
+  uint32_t failures;
+  std::vector<uint32_t> latencies_us;
+};
+
+
+/* Get CO2 value in a loop and save latency of every transaction */
+static void run_worker(Worker *worker) {
+  S8_posix_transport transport(worker->device);
+
+  if (!transport.begin()) {
+    worker->failures++;
+    return;
+  }
+
+  S8_UART sensor_S8(transport);
+  sensor_S8.set_tx_flush(worker->flush);
+  uint32_t start = millis();
+
+  while ((millis() - start) < worker->seconds * 1000) {
+    uint32_t t0 = micros();
+    int16_t co2 = sensor_S8.get_co2();
+    worker->latencies_us.push_back(micros() - t0);
+
+    worker->transactions++;
+    if (co2 != 400) {
+      worker->failures++;
+    }
+  }
+}
+
+
+/* CPU time of this process in microseconds */
+static uint64_t cpu_time_us() {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return (uint64_t)(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000ull + usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+}
+
+
+int main(int argc, char *argv[]) {
+
+  int count = (argc > 1) ? atoi(argv[1]) : 10;
+  uint32_t seconds = (argc > 2) ? atoi(argv[2]) : 10;
+  uint32_t baudrate = (argc > 3) ? atoi(argv[3]) : S8_BAUDRATE;
+  bool flush = (argc > 4) ? atoi(argv[4]) != 0 : true;
+
+  // Emulated sensors, served by a child process
+  S8_pty_emulator emulator;
+  if (count <= 0 || !emulator.begin(count)) {
+    return 1;
+  }
+  emulator.set_pacing(baudrate, TURNAROUND_US);
+
+  pid_t child = fork();
+  if (child == 0) {
+    while (emulator.serve_once(100) >= 0 && getppid() != 1) {
+    }
+    _exit(0);
+  }
+
+  // One thread per sensor
+  std::vector<Worker> workers(count);
+  std::vector<std::thread> threads;
+
+  uint64_t cpu_start = cpu_time_us();
+  uint32_t start = millis();
+
+  for (int i = 0; i < count; i++) {
+    workers[i].device = emulator.name(i);
+    workers[i].seconds = seconds;
+    workers[i].flush = flush;
+    workers[i].transactions = 0;
+    workers[i].failures = 0;
+    threads.push_back(std::thread(run_worker, &workers[i]));
+  }
+
+  for (size_t i = 0; i < threads.size(); i++) {
+    threads[i].join();
+  }
+
+  uint32_t elapsed = millis() - start;
+  uint64_t cpu = cpu_time_us() - cpu_start;
+
+  kill(child, SIGTERM);
+  waitpid(child, NULL, 0);
+
+  // Results
+  std::vector<uint32_t> latencies;
+  uint32_t transactions = 0;
+  uint32_t failures = 0;
+
+  for (int i = 0; i < count; i++) {
+    transactions += workers[i].transactions;
+    failures += workers[i].failures;
+    latencies.insert(latencies.end(), workers[i].latencies_us.begin(), workers[i].latencies_us.end());
+  }
+
+  if (latencies.empty()) {
+    printf("No transactions!\n");
+    return 1;
+  }
+
+  std::sort(latencies.begin(), latencies.end());
+
+  printf("Sensors: %d, baudrate: %u, time: %u ms\n", count, baudrate, elapsed);
+  printf("Transactions: %u (%.1f/s), failures: %u\n", transactions, transactions * 1000.0 / elapsed, failures);
+  printf("Latency: p50 %u us, p99 %u us, max %u us\n", latencies[latencies.size() / 2],
+         latencies[latencies.size() * 99 / 100], latencies.back());
+  printf("CPU: %.1f us/transaction\n", (double)cpu / transactions);
+
+  return (failures > 0) ? 1 : 0;
+}
@@ -0,0 +1,102 @@
+/****************************************************************************
+   Cost of an OpenMetrics scrape with many sensors
+
+   Sensors are read once from mock devices, then the exposition is written
+   many times into a buffer and through a small window to /dev/null.
+
+     ./build/s8_metrics_bench [sensors] [scrapes]
+
+   With 0 scrapes it prints the exposition.
+ ****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include "s8_uart.h"
+#include "s8_mock.h"
+#include "s8_metrics.h"
+
+
+#define WINDOW_SIZE  256    // Buffer used to stream to a FILE
+
+
+int main(int argc, char *argv[]) {
+
+  int count = (argc > 1) ? atoi(argv[1]) : 100;
+  int scrapes = (argc > 2) ? atoi(argv[2]) : 1000;
+
+  if (count <= 0 || count > 255) {
+    printf("Sensors must be 1 - 255\n");
+    return 1;
+  }
+
+  // Sensors with some transactions in the counters
+  std::vector<S8_mock_device> devices(count);
+  std::vector<S8_mock_transport *> transports;
+  std::vector<S8_UART *> sensors;
+  std::vector<S8_sensor> data(count);
+  std::vector<S8_metrics_source> sources(count);
+  std::vector<std::vector<char> > names(count, std::vector<char>(16));
+
+  for (int i = 0; i < count; i++) {
+    devices[i].input_regs[MODBUS_IR4] = 400 + i;
+    transports.push_back(new S8_mock_transport(devices[i]));
+    sensors.push_back(new S8_UART(*transports[i]));
+
+    sensors[i]->get_firmware_version(data[i].firm_version);
+    data[i].sensor_id = sensors[i]->get_sensor_ID();
+    data[i].sensor_type_id = sensors[i]->get_sensor_type_ID();
+    data[i].map_version = sensors[i]->get_memory_map_version();
+    data[i].abc_period = sensors[i]->get_ABC_period();
+    data[i].co2 = sensors[i]->get_co2();
+    data[i].meter_status = sensors[i]->get_meter_status();
+
+    snprintf(&names[i][0], 16, "s8_%d", i);
+    sources[i].name = &names[i][0];
+    sources[i].sensor = &data[i];
+    sources[i].link = &sensors[i]->link_stats();
+  }
+
+  if (scrapes == 0) {
+    char window[WINDOW_SIZE];
+    S8_writer out(stdout, window, sizeof(window));
+    S8_write_openmetrics(out, &sources[0], count);
+    return 0;
+  }
+
+  // Into a buffer big enough for all the exposition
+  std::vector<char> buf(count * 2048);
+  size_t bytes = 0;
+  uint32_t start = micros();
+
+  for (int n = 0; n < scrapes; n++) {
+    S8_writer out(&buf[0], buf.size());
+    S8_write_openmetrics(out, &sources[0], count);
+    if (out.overflow()) {
+      printf("Buffer overflow!\n");
+      return 1;
+    }
+    bytes = out.length();
+  }
+
+  uint32_t buffer_us = micros() - start;
+
+  // Through a small window
+  FILE *null = fopen("/dev/null", "w");
+  char window[WINDOW_SIZE];
+  start = micros();
+
+  for (int n = 0; n < scrapes; n++) {
+    S8_writer out(null, window, sizeof(window));
+    S8_write_openmetrics(out, &sources[0], count);
+  }
+
+  uint32_t stream_us = micros() - start;
+  fclose(null);
+
+  printf("Sensors: %d, scrapes: %d, exposition: %u bytes\n", count, scrapes, (unsigned int)bytes);
+  printf("Into buffer: %.1f us/scrape (%.0f ns/sensor)\n", (double)buffer_us / scrapes, buffer_us * 1000.0 / scrapes / count);
+  printf("Streamed (%d bytes window): %.1f us/scrape (%.0f ns/sensor)\n", WINDOW_SIZE, (double)stream_us / scrapes, stream_us * 1000.0 / scrapes / count);
+
+  return 0;
+}
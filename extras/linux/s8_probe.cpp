@@ -0,0 +1,74 @@
+/**********************************************
+   Detect SenseAir S8 sensors in serial ports
+   of Linux, all ports are probed in parallel
+ **********************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "s8_uart.h"
+#include "s8_transport_posix.h"
+
+
+#define MAX_PORTS 16
+
+
+int main(int argc, char *argv[]) {
+
+  if (argc < 2) {
+    printf("Usage: %s <serial device> [serial device ...] [-t timeout_ms]  (ex: /dev/ttyUSB0 /dev/ttyUSB1)\n", argv[0]);
+    return 1;
+  }
+
+  S8_posix_transport *transports[MAX_PORTS];
+  S8_UART *sensors[MAX_PORTS];
+  const char *names[MAX_PORTS];
+  uint8_t results[MAX_PORTS];
+  uint32_t timeout_ms = S8_PROBE_TIMEOUT;
+  uint8_t count = 0;
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+      timeout_ms = atoi(argv[++i]);
+      continue;
+    }
+
+    if (count == MAX_PORTS) {
+      printf("Too many ports, maximum %d\n", MAX_PORTS);
+      return 1;
+    }
+
+    S8_posix_transport *transport = new S8_posix_transport(argv[i]);
+    if (!transport->begin()) {
+      printf("%s: can't open\n", argv[i]);
+      delete transport;
+      continue;
+    }
+
+    transports[count] = transport;
+    sensors[count] = new S8_UART(*transport);
+    names[count] = argv[i];
+    count++;
+  }
+
+  uint32_t start_t = millis();
+  S8_UART::probe_all(sensors, count, results, timeout_ms);
+  uint32_t elapsed = millis() - start_t;
+
+  int found = 0;
+  for (uint8_t i = 0; i < count; i++) {
+    if (results[i] == S8_PROBE_FOUND) {
+      printf("%s: sensor found\n", names[i]);
+      found++;
+    } else if (results[i] == S8_PROBE_NOISE) {
+      printf("%s: noise, no valid response\n", names[i]);
+    } else {
+      printf("%s: no response\n", names[i]);
+    }
+    delete sensors[i];
+    delete transports[i];
+  }
+
+  printf("%d sensor(s) found in %u ms\n", found, (unsigned int)elapsed);
+
+  return (found > 0) ? 0 : 1;
+}
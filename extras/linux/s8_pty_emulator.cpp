@@ -0,0 +1,188 @@
+/*
+   Emulated S8 sensors on pseudo-terminals (host tools)
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+#include <time.h>
+#include "s8_pty_emulator.h"
+
+
+/* Monotonic time in microseconds */
+static uint64_t now_us() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ull + ts.tv_nsec / 1000;
+}
+
+
+S8_pty_emulator::S8_pty_emulator() {
+    sensors = NULL;
+    fds = NULL;
+    n = 0;
+    byte_us = 0;
+    turnaround_us = 0;
+}
+
+
+S8_pty_emulator::~S8_pty_emulator() {
+    end();
+}
+
+
+/* Create a pseudo-terminal for every sensor, slaves are left in raw mode */
+bool S8_pty_emulator::begin(int count) {
+    struct termios tty;
+
+    end();
+    sensors = new Sensor[count];
+    fds = new struct pollfd[count];
+
+    for (n = 0; n < count; n++) {
+        Sensor &sensor = sensors[n];
+
+        sensor.master = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK);
+        if (sensor.master < 0 || grantpt(sensor.master) != 0 || unlockpt(sensor.master) != 0) {
+            perror("posix_openpt");
+            return false;
+        }
+
+        snprintf(sensor.name, sizeof(sensor.name), "%s", ptsname(sensor.master));
+        sensor.slave = open(sensor.name, O_RDWR | O_NOCTTY);
+        if (sensor.slave < 0) {
+            perror(sensor.name);
+            close(sensor.master);
+            return false;
+        }
+
+        tcgetattr(sensor.slave, &tty);
+        cfmakeraw(&tty);
+        tcsetattr(sensor.slave, TCSANOW, &tty);
+
+        sensor.len = 0;
+        sensor.tx_len = 0;
+        sensor.tx_pos = 0;
+        fds[n].fd = sensor.master;
+        fds[n].events = POLLIN;
+    }
+
+    return true;
+}
+
+
+void S8_pty_emulator::end() {
+    for (int i = 0; i < n; i++) {
+        close(sensors[i].slave);
+        close(sensors[i].master);
+    }
+
+    delete[] sensors;
+    delete[] fds;
+    sensors = NULL;
+    fds = NULL;
+    n = 0;
+}
+
+
+const char *S8_pty_emulator::name(int index) const {
+    return sensors[index].name;
+}
+
+
+void S8_pty_emulator::set_pacing(uint32_t baudrate, uint32_t turnaround_us) {
+    byte_us = (baudrate > 0) ? (10 * 1000000ul + baudrate - 1) / baudrate : 0;
+    this->turnaround_us = turnaround_us;
+}
+
+
+/* Wait requests of all sensors and answer them */
+int S8_pty_emulator::serve_once(int timeout_ms) {
+    int answered = 0;
+    uint64_t now = now_us();
+
+    // Wake up for next paced byte
+    if (byte_us > 0) {
+        for (int i = 0; i < n; i++) {
+            if (sensors[i].tx_pos < sensors[i].tx_len) {
+                int wait_ms = (sensors[i].tx_next_us > now) ? (sensors[i].tx_next_us - now + 999) / 1000 : 0;
+                if (timeout_ms < 0 || wait_ms < timeout_ms) {
+                    timeout_ms = wait_ms;
+                }
+            }
+        }
+    }
+
+    int ready = poll(fds, n, timeout_ms);
+    if (ready < 0) {
+        return -1;
+    }
+
+    now = now_us();
+    for (int i = 0; i < n; i++) {
+        if (fds[i].revents & POLLIN) {
+            answered += receive(sensors[i], now);
+        }
+        if (sensors[i].tx_pos < sensors[i].tx_len) {
+            transmit(sensors[i], now);
+        }
+    }
+
+    return answered;
+}
+
+
+/* Write bytes of the response that are due */
+void S8_pty_emulator::transmit(Sensor &sensor, uint64_t now) {
+    uint8_t nb = 0;
+
+    while (sensor.tx_pos + nb < sensor.tx_len && sensor.tx_next_us + nb * byte_us <= now) {
+        nb++;
+    }
+
+    if (nb > 0) {
+        ssize_t sent = write(sensor.master, &sensor.tx[sensor.tx_pos], nb);
+        if (sent > 0) {
+            sensor.tx_pos += sent;
+            sensor.tx_next_us += sent * byte_us;
+        }
+    }
+}
+
+
+/* Read bytes of a sensor and answer complete requests, on invalid frame discard first byte to resynchronize */
+int S8_pty_emulator::receive(Sensor &sensor, uint64_t now) {
+    uint8_t response[S8_MOCK_LEN_FRAME];
+    int answered = 0;
+    ssize_t nb;
+
+    while ((nb = read(sensor.master, &sensor.request[sensor.len], sizeof(sensor.request) - sensor.len)) > 0) {
+        sensor.len += nb;
+
+        if (sensor.len == sizeof(sensor.request)) {
+            uint8_t len = sensor.device.process(sensor.request, sensor.len, response);
+
+            if (len > 0) {
+                if (byte_us > 0) {
+                    memcpy(sensor.tx, response, len);
+                    sensor.tx_len = len;
+                    sensor.tx_pos = 0;
+                    sensor.tx_next_us = now + sizeof(sensor.request) * byte_us + turnaround_us + byte_us;
+                    answered++;
+                } else if (write(sensor.master, response, len) == len) {
+                    answered++;
+                }
+                sensor.len = 0;
+
+            } else {
+                memmove(sensor.request, sensor.request + 1, --sensor.len);
+            }
+        }
+    }
+
+    return answered;
+}
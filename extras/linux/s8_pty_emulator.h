@@ -0,0 +1,58 @@
+/*
+   Emulated S8 sensors on pseudo-terminals (host tools)
+
+   Every sensor is a pseudo-terminal answering Modbus requests from an S8_mock_device.
+   The clients open the slave device returned by name().
+
+   With pacing, a response starts after the time to receive the request at the baudrate plus a
+   turnaround time, and its bytes are written one by one at the baudrate (8N1, 10 bits per byte).
+*/
+
+#ifndef _S8_PTY_EMULATOR_H
+    #define _S8_PTY_EMULATOR_H
+
+    #include <stdint.h>
+    #include <poll.h>
+    #include "s8_mock.h"
+
+
+    class S8_pty_emulator
+    {
+        public:
+            S8_pty_emulator();
+            ~S8_pty_emulator();
+
+            bool begin(int count);                                                  // Create pseudo-terminals
+            void end();                                                             // Close them
+            int count() const { return n; }
+            const char *name(int index) const;                                      // Slave device of a sensor (ex: /dev/pts/3)
+            S8_mock_device &device(int index) { return sensors[index].device; }
+
+            void set_pacing(uint32_t baudrate, uint32_t turnaround_us);            // Baudrate to emulate (0 = no pacing)
+            int serve_once(int timeout_ms);                                         // Answer received requests (returns answered requests, -1 on error)
+
+        private:
+            struct Sensor {
+                int master;
+                int slave;                                                          // Kept opened so the port stays between clients
+                char name[32];
+                uint8_t request[8];
+                uint8_t len;
+                uint8_t tx[S8_MOCK_LEN_FRAME];                                      // Response being sent
+                uint8_t tx_len;
+                uint8_t tx_pos;
+                uint64_t tx_next_us;                                                // Time to send next byte
+                S8_mock_device device;
+            };
+
+            Sensor *sensors;
+            struct pollfd *fds;
+            int n;
+            uint32_t byte_us;                                                       // Time of a byte (0 = no pacing)
+            uint32_t turnaround_us;
+
+            int receive(Sensor &sensor, uint64_t now_us);
+            void transmit(Sensor &sensor, uint64_t now_us);
+    };
+
+#endif
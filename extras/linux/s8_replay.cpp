@@ -0,0 +1,129 @@
+/****************************************************************************
+   Replay a trace of the traffic with a sensor (S8_capture_transport)
+
+   Every request of the trace is sent again through S8_UART and the bytes
+   received in the trace are given back with the original timing, so the
+   library processes the same traffic, with the same timing, as in the field.
+
+     ./build/s8_replay <trace file> [-f] [-q]
+
+     -f   Fast, received bytes are available at once (benchmark of parser)
+     -q   Quiet, only summary
+ ****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include "s8_uart.h"
+#include "s8_trace.h"
+
+
+static const char *status_name(uint8_t status) {
+  switch (status) {
+    case S8_TRANSACTION_DONE: return "done";
+    case S8_TRANSACTION_ERROR: return "error";
+    case S8_TRANSACTION_TIMEOUT: return "timeout";
+    default: return "?";
+  }
+}
+
+
+int main(int argc, char *argv[]) {
+
+  const char *file = NULL;
+  bool fast = false;
+  bool quiet = false;
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-f") == 0) {
+      fast = true;
+    } else if (strcmp(argv[i], "-q") == 0) {
+      quiet = true;
+    } else {
+      file = argv[i];
+    }
+  }
+
+  if (file == NULL) {
+    printf("Usage: %s <trace file> [-f] [-q]\n", argv[0]);
+    return 1;
+  }
+
+  // Load trace
+  FILE *f = fopen(file, "rb");
+  if (f == NULL) {
+    printf("Can't open %s!\n", file);
+    return 1;
+  }
+
+  std::vector<uint8_t> trace;
+  uint8_t chunk[4096];
+  size_t n;
+  while ((n = fread(chunk, 1, sizeof(chunk), f)) > 0) {
+    trace.insert(trace.end(), chunk, chunk + n);
+  }
+  fclose(f);
+
+  S8_replay_transport transport(trace.data(), trace.size(), !fast);
+  S8_trace_reader check(trace.data(), trace.size());
+  if (!check.valid()) {
+    printf("%s is not a trace!\n", file);
+    return 1;
+  }
+
+  S8_UART sensor_S8(transport);
+  if (fast) {
+    sensor_S8.set_timeout(1);   // Missing bytes will not arrive later
+  }
+
+  uint8_t request[S8_TRACE_MAX_DATA];
+  uint8_t len;
+  uint32_t counts[5] = { 0 };
+  uint32_t skipped = 0;
+  uint32_t start = micros();
+
+  while (transport.next_request(request, len)) {
+
+    if (len != 8) {
+      skipped++;
+      continue;
+    }
+
+    // Same time between requests as in the trace
+    if (!fast) {
+      int32_t wait_us = (int32_t)(transport.request_time_us() - (micros() - start));
+      if (wait_us > 1000) {
+        delay(wait_us / 1000);
+      }
+    }
+
+    uint8_t func = request[1];
+    uint16_t reg = (request[2] << 8) | request[3];
+    uint16_t value = (request[4] << 8) | request[5];
+    bool sent = (func == MODBUS_FUNC_WRITE_SINGLE_REGISTER) ? sensor_S8.request_write(reg, value) : sensor_S8.request_read(func, reg, value);
+
+    if (!sent) {
+      skipped++;
+      continue;
+    }
+
+    uint32_t t0 = micros();
+    uint8_t status = sensor_S8.wait_transaction();
+    counts[status]++;
+
+    if (!quiet) {
+      printf("%10.3f ms  func 0x%02X reg %3u value %5u -> %-7s %6u us\n", transport.request_time_us() / 1000.0,
+             func, reg, value, status_name(status), (unsigned int)(micros() - t0));
+    }
+  }
+
+  uint32_t elapsed = micros() - start;
+  const S8_link_stats &stats = sensor_S8.link_stats();
+
+  printf("Transactions: %u (done %u, errors %u, timeouts %u), skipped requests: %u, mismatches: %u\n",
+         (unsigned int)stats.transactions, (unsigned int)counts[S8_TRANSACTION_DONE], (unsigned int)counts[S8_TRANSACTION_ERROR],
+         (unsigned int)counts[S8_TRANSACTION_TIMEOUT], (unsigned int)skipped, (unsigned int)transport.mismatches);
+  printf("Replay time: %.3f ms (%.2f us/transaction)\n", elapsed / 1000.0, stats.transactions ? (double)elapsed / stats.transactions : 0.0);
+
+  return 0;
+}
@@ -0,0 +1,133 @@
+/****************************************************************************
+   Stress test of S8_shared, many threads use the same emulated sensor
+
+   Threads read CO2, meter status and sensor ID and write the ABC period
+   at random through one S8_shared. Identical reads at the same time are
+   answered with one transaction of the bus.
+
+     ./build/s8_shared_stress [threads] [seconds] [baudrate, 0 = no pacing]
+
+   It returns 1 if any request fails or gets a corrupted value.
+ ****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <thread>
+#include <vector>
+#include "s8_uart.h"
+#include "s8_shared.h"
+#include "s8_transport_posix.h"
+#include "s8_pty_emulator.h"
+
+
+#define TURNAROUND_US  2000     // Time of the emulated sensor to answer
+
+
+struct Worker {
+  S8_shared *shared;
+  uint32_t seconds;
+  unsigned int seed;
+  uint32_t requests;
+  uint32_t failures;
+};
+
+
+/* Random mix of requests, check every value with the emulated sensor */
+static void run_worker(Worker *worker) {
+  uint32_t start = millis();
+
+  while ((millis() - start) < worker->seconds * 1000) {
+    bool ok;
+    int r = rand_r(&worker->seed) % 100;
+
+    if (r < 60) {
+      int16_t co2;
+      ok = worker->shared->read<S8_reg_co2>(co2) && co2 == 400;
+    } else if (r < 85) {
+      int16_t status;
+      ok = worker->shared->read<S8_reg_meter_status>(status) && status == 0;
+    } else if (r < 98) {
+      int32_t id;
+      ok = worker->shared->read<S8_reg_sensor_id>(id) && id == 0x0A0B0C0D;
+    } else {
+      ok = worker->shared->write(MODBUS_HR32, 180);
+    }
+
+    worker->requests++;
+    if (!ok) {
+      worker->failures++;
+    }
+  }
+}
+
+
+int main(int argc, char *argv[]) {
+
+  int count = (argc > 1) ? atoi(argv[1]) : 8;
+  uint32_t seconds = (argc > 2) ? atoi(argv[2]) : 5;
+  uint32_t baudrate = (argc > 3) ? atoi(argv[3]) : S8_BAUDRATE;
+
+  // Emulated sensor, served by a child process
+  S8_pty_emulator emulator;
+  if (count <= 0 || !emulator.begin(1)) {
+    return 1;
+  }
+  emulator.set_pacing(baudrate, TURNAROUND_US);
+
+  pid_t child = fork();
+  if (child == 0) {
+    while (emulator.serve_once(100) >= 0 && getppid() != 1) {
+    }
+    _exit(0);
+  }
+
+  S8_posix_transport transport(emulator.name(0));
+  if (!transport.begin()) {
+    kill(child, SIGTERM);
+    return 1;
+  }
+
+  S8_UART sensor_S8(transport);
+  S8_shared shared(sensor_S8);
+
+  // Threads sharing the sensor
+  std::vector<Worker> workers(count);
+  std::vector<std::thread> threads;
+  uint32_t start = millis();
+
+  for (int i = 0; i < count; i++) {
+    workers[i].shared = &shared;
+    workers[i].seconds = seconds;
+    workers[i].seed = i + 1;
+    workers[i].requests = 0;
+    workers[i].failures = 0;
+    threads.push_back(std::thread(run_worker, &workers[i]));
+  }
+
+  for (size_t i = 0; i < threads.size(); i++) {
+    threads[i].join();
+  }
+
+  uint32_t elapsed = millis() - start;
+
+  kill(child, SIGTERM);
+  waitpid(child, NULL, 0);
+
+  // Results
+  uint32_t requests = 0;
+  uint32_t failures = 0;
+
+  for (int i = 0; i < count; i++) {
+    requests += workers[i].requests;
+    failures += workers[i].failures;
+  }
+
+  printf("Threads: %d, baudrate: %u, time: %u ms\n", count, baudrate, elapsed);
+  printf("Requests: %u (%.1f/s), failures: %u\n", requests, requests * 1000.0 / elapsed, failures);
+  printf("Bus transactions: %u (%.1f/s), coalesced reads: %u\n", shared.transactions, shared.transactions * 1000.0 / elapsed, shared.coalesced);
+
+  return (failures > 0 || requests == 0) ? 1 : 0;
+}
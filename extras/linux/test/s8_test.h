@@ -0,0 +1,36 @@
+/****************************************************************************
+   Minimal checks for the host unit tests (make test)
+
+   Every test program calls its test functions from main() and returns
+   S8_TEST_RESULT(), 1 if any check failed.
+ ****************************************************************************/
+
+#ifndef _S8_TEST_H
+#define _S8_TEST_H
+
+#include <stdio.h>
+
+static int s8_test_checks = 0;
+static int s8_test_failures = 0;
+
+#define CHECK(cond) do { \
+    s8_test_checks++; \
+    if (!(cond)) { \
+      s8_test_failures++; \
+      printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+    } \
+  } while (0)
+
+#define CHECK_EQUAL(expected, actual) do { \
+    long long e_ = (long long)(expected), a_ = (long long)(actual); \
+    s8_test_checks++; \
+    if (e_ != a_) { \
+      s8_test_failures++; \
+      printf("%s:%d: %s expected %lld, got %lld\n", __FILE__, __LINE__, #actual, e_, a_); \
+    } \
+  } while (0)
+
+#define S8_TEST_RESULT() \
+  (printf("%s: %d checks, %d failures\n", __FILE__, s8_test_checks, s8_test_failures), s8_test_failures != 0)
+
+#endif
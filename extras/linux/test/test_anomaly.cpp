@@ -0,0 +1,119 @@
+/****************************************************************************
+   Unit tests of S8_anomaly (flatline, rate of change, range and PWM checks)
+ ****************************************************************************/
+
+#include "s8_anomaly.h"
+#include "s8_test.h"
+
+
+static uint32_t changes;
+static uint8_t last_flags;
+
+static void on_change(uint8_t flags) {
+  changes++;
+  last_flags = flags;
+}
+
+
+static void test_flatline_tolerance() {
+  S8_anomaly anomaly;
+
+  anomaly.set_flatline(10000, 5);
+
+  // Noise inside the tolerance is still a flat value
+  uint32_t t = 0;
+  for (int i = 0; i < 5; i++, t += 2000) {
+    CHECK_EQUAL(0, anomaly.add(t, (i & 1) ? 405 : 400, 0));
+  }
+  CHECK_EQUAL(S8_ANOMALY_FLATLINE, anomaly.add(t, 395, 0));      // 10 s since 400, drift is -5
+
+  // A change bigger than the tolerance starts a new flat period
+  t += 2000;
+  CHECK_EQUAL(0, anomaly.add(t, 406, 0));
+  CHECK_EQUAL(0, anomaly.add(t + 9999, 406, 0));
+  CHECK_EQUAL(S8_ANOMALY_FLATLINE, anomaly.add(t + 10000, 406, 0));
+
+  // Without tolerance any change clears it
+  anomaly.set_flatline(10000);
+  anomaly.reset();
+  CHECK_EQUAL(0, anomaly.add(0, 400, 0));
+  CHECK_EQUAL(S8_ANOMALY_FLATLINE, anomaly.add(10000, 400, 0));
+  CHECK_EQUAL(0, anomaly.add(12000, 401, 0));
+  CHECK_EQUAL(0, anomaly.add(21000, 401, 0));
+}
+
+
+static void test_rate_window() {
+  S8_anomaly anomaly;
+
+  anomaly.set_max_rate(100);
+
+  CHECK_EQUAL(0, anomaly.add(0, 400, 0));
+  CHECK_EQUAL(0, anomaly.add(1000, 500, 0));                      // 100 ppm/s is allowed
+  CHECK_EQUAL(S8_ANOMALY_RATE, anomaly.add(2000, 601, 0));
+  CHECK_EQUAL(0, anomaly.add(3000, 650, 0));                      // Cleared by the next reading
+  CHECK_EQUAL(0, anomaly.add(3000, 2000, 0));                     // Same time, the rate is unknown
+
+  // Readings far apart are not compared
+  CHECK_EQUAL(S8_ANOMALY_RATE, anomaly.add(4000, 400, 0));
+  CHECK_EQUAL(S8_ANOMALY_RATE, anomaly.add(4000 + S8_ANOMALY_RATE_WINDOW, 9000, 0));
+  CHECK_EQUAL(0, anomaly.add(4000 + 2 * S8_ANOMALY_RATE_WINDOW + 1, 400, 0));
+
+  // Biggest change at the biggest rate does not overflow
+  anomaly.set_max_rate(65535);
+  anomaly.set_range(-32768, 32767);
+  anomaly.reset();
+  anomaly.add(0, -32768, 0);
+  CHECK_EQUAL(0, anomaly.add(S8_ANOMALY_RATE_WINDOW, 32767, S8_MASK_METER_OUT_OF_RANGE) & S8_ANOMALY_RATE);
+  CHECK_EQUAL(S8_ANOMALY_RATE, anomaly.add(S8_ANOMALY_RATE_WINDOW + 1, -32768, 0) & S8_ANOMALY_RATE);
+}
+
+
+static void test_pwm_saturation() {
+  S8_anomaly anomaly;
+
+  CHECK_EQUAL(0, anomaly.add_pwm(0));                             // No CO2 value yet
+
+  anomaly.add(0, 400, 0);
+  CHECK_EQUAL(0, anomaly.add_pwm(3277));                          // 400 ppm of 2000 ppm full scale
+  CHECK_EQUAL(S8_ANOMALY_PWM, anomaly.add_pwm(S8_ANOMALY_PWM_RAW_MAX));
+
+  // Above full scale the output stays at 100 %
+  anomaly.add(1000, 480, 0);
+  anomaly.add(60000, 3000, 0);
+  CHECK_EQUAL(0, anomaly.add_pwm(S8_ANOMALY_PWM_RAW_MAX));
+  CHECK_EQUAL(S8_ANOMALY_PWM, anomaly.add_pwm(S8_ANOMALY_PWM_RAW_MAX / 2));
+
+  // Extended range version (10000 ppm at 100 %), inside the tolerance
+  anomaly.set_pwm(10000, 100);
+  CHECK_EQUAL(0, anomaly.add_pwm(4915 - 100));
+  CHECK_EQUAL(S8_ANOMALY_PWM, anomaly.add_pwm(4915 - 300));
+}
+
+
+static void test_range_and_status() {
+  S8_anomaly anomaly;
+
+  changes = 0;
+  anomaly.on_change(on_change);
+
+  CHECK_EQUAL(0, anomaly.add(0, 400, 0));
+  CHECK_EQUAL(S8_ANOMALY_RANGE, anomaly.add(1000000, 12000, S8_MASK_METER_OUT_OF_RANGE));
+  CHECK_EQUAL(S8_ANOMALY_RANGE | S8_ANOMALY_STATUS, anomaly.add(2000000, 12000, 0));
+  CHECK_EQUAL(S8_ANOMALY_RANGE | S8_ANOMALY_STATUS, anomaly.add(3000000, 500, S8_MASK_METER_OUT_OF_RANGE));
+  CHECK_EQUAL(0, anomaly.add(4000000, 501, 0));
+
+  CHECK_EQUAL(2, anomaly.events);
+  CHECK_EQUAL(3, changes);
+  CHECK_EQUAL(0, last_flags);
+}
+
+
+int main() {
+  test_flatline_tolerance();
+  test_rate_window();
+  test_pwm_saturation();
+  test_range_and_status();
+
+  return S8_TEST_RESULT();
+}
@@ -0,0 +1,132 @@
+/****************************************************************************
+   Unit tests of S8_cache (expiry of the time to live and invalidation after writes)
+ ****************************************************************************/
+
+#include "s8_cache.h"
+#include "s8_uart.h"
+#include "s8_mock.h"
+#include "s8_test.h"
+
+
+/* Fill every entry with a known value */
+static void fill(S8_cache &cache) {
+  cache.put(S8_reg_co2::func, S8_reg_co2::addr, 600);
+  cache.put(S8_reg_meter_status::func, S8_reg_meter_status::addr, 0);
+  cache.put(S8_reg_acknowledgement::func, S8_reg_acknowledgement::addr, 0x20);
+  cache.put(S8_reg_abc_period::func, S8_reg_abc_period::addr, 180);
+  cache.put(S8_reg_sensor_id::func, S8_reg_sensor_id::addr, 0x12345678);
+}
+
+
+static bool cached(S8_cache &cache, uint8_t func, uint16_t addr, int32_t &value) {
+  return cache.get(func, addr, value);
+}
+
+
+static void test_ttl() {
+  S8_cache cache;
+  int32_t value = 0;
+
+  CHECK(!cached(cache, S8_reg_co2::func, S8_reg_co2::addr, value));
+  cache.put(S8_reg_co2::func, S8_reg_co2::addr, 612);
+  CHECK(cached(cache, S8_reg_co2::func, S8_reg_co2::addr, value));
+  CHECK_EQUAL(612, value);
+
+  // Short time to live, the value expires
+  cache.set_ttl<S8_reg_co2>(50);
+  cache.put(S8_reg_co2::func, S8_reg_co2::addr, 650);
+  CHECK(cached(cache, S8_reg_co2::func, S8_reg_co2::addr, value));
+  CHECK_EQUAL(650, value);
+  delay(60);
+  CHECK(!cached(cache, S8_reg_co2::func, S8_reg_co2::addr, value));
+  CHECK_EQUAL(2, cache.hits);
+  CHECK_EQUAL(2, cache.misses);
+
+  // Values that never expire
+  cache.put(S8_reg_sensor_id::func, S8_reg_sensor_id::addr, 0x12345678);
+  delay(60);
+  int32_t id = 0;
+  CHECK(cached(cache, S8_reg_sensor_id::func, S8_reg_sensor_id::addr, id));
+  CHECK_EQUAL(0x12345678, id);
+
+  cache.set_ttl<S8_reg_co2>(0);     // Zero disables caching
+  cache.put(S8_reg_co2::func, S8_reg_co2::addr, 700);
+  CHECK(!cached(cache, S8_reg_co2::func, S8_reg_co2::addr, value));
+  CHECK_EQUAL(650, value);          // Not changed by a miss
+}
+
+
+static void test_write_abc_period() {
+  S8_cache cache;
+  int32_t value = 0;
+
+  fill(cache);
+  cache.written(MODBUS_HR32, 90);
+
+  CHECK(cached(cache, S8_reg_abc_period::func, S8_reg_abc_period::addr, value));
+  CHECK_EQUAL(90, value);                                                   // Echo is the new value
+  CHECK(cached(cache, S8_reg_co2::func, S8_reg_co2::addr, value));          // Measures unchanged
+  CHECK(cached(cache, S8_reg_acknowledgement::func, S8_reg_acknowledgement::addr, value));
+}
+
+
+static void test_write_acknowledgement() {
+  S8_cache cache;
+  int32_t value = 0;
+
+  fill(cache);
+  cache.written(MODBUS_HR1, 0);
+
+  CHECK(!cached(cache, S8_reg_acknowledgement::func, S8_reg_acknowledgement::addr, value));
+  CHECK(cached(cache, S8_reg_co2::func, S8_reg_co2::addr, value));
+  CHECK(cached(cache, S8_reg_abc_period::func, S8_reg_abc_period::addr, value));
+}
+
+
+static void test_write_special_command() {
+  S8_cache cache;
+  int32_t value = 0;
+
+  fill(cache);
+  cache.written(MODBUS_HR2, S8_CO2_BACKGROUND_CALIBRATION);
+
+  CHECK(!cached(cache, S8_reg_acknowledgement::func, S8_reg_acknowledgement::addr, value));
+  CHECK(!cached(cache, S8_reg_co2::func, S8_reg_co2::addr, value));
+  CHECK(!cached(cache, S8_reg_meter_status::func, S8_reg_meter_status::addr, value));
+  CHECK(cached(cache, S8_reg_abc_period::func, S8_reg_abc_period::addr, value));   // Configuration and identity kept
+  int32_t id = 0;
+  CHECK(cached(cache, S8_reg_sensor_id::func, S8_reg_sensor_id::addr, id));
+  CHECK_EQUAL(0x12345678, id);
+}
+
+
+/* Through S8_UART: a read is served from the cache, a write of HR32 updates it */
+static void test_uart() {
+  S8_mock_device device;
+  S8_mock_transport transport(device);
+  S8_UART sensor(transport);
+  S8_cache cache;
+
+  sensor.set_cache(&cache);
+  device.holding_regs[MODBUS_HR32] = 180;
+
+  CHECK_EQUAL(180, sensor.get_ABC_period());
+  uint32_t transactions = sensor.link_stats().transactions;
+  CHECK_EQUAL(180, sensor.get_ABC_period());
+  CHECK_EQUAL(transactions, sensor.link_stats().transactions);             // Hit, no transaction
+
+  CHECK(sensor.set_ABC_period(360));
+  CHECK_EQUAL(360, sensor.get_ABC_period());
+  CHECK_EQUAL(S8_CONFIG_UNCHANGED, sensor.apply_ABC_period(360));
+}
+
+
+int main() {
+  test_ttl();
+  test_write_abc_period();
+  test_write_acknowledgement();
+  test_write_special_command();
+  test_uart();
+
+  return S8_TEST_RESULT();
+}
@@ -0,0 +1,66 @@
+/****************************************************************************
+   Unit tests of S8_epoll_engine (hang-up of a port)
+ ****************************************************************************/
+
+#include "s8_epoll.h"
+#include "s8_transport_posix.h"
+#include "s8_test.h"
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+
+static uint32_t finished;
+static uint8_t last_status;
+
+static void on_finish(void *context, int index, S8_UART &sensor, uint8_t status) {
+  finished++;
+  last_status = status;
+}
+
+
+/* The sensor side closes while a request is pending, the engine must not spin on the closed port */
+static void test_hangup_ends_transaction() {
+  int master = posix_openpt(O_RDWR | O_NOCTTY);
+  CHECK(master >= 0 && grantpt(master) == 0 && unlockpt(master) == 0);
+  int slave = open(ptsname(master), O_RDWR | O_NOCTTY);
+  CHECK(slave >= 0);
+
+  S8_posix_transport transport(slave);
+  CHECK(transport.begin());
+  S8_UART sensor(transport);
+
+  S8_epoll_engine engine;
+  CHECK(engine.begin(1, 1000));
+  engine.set_callback(on_finish, NULL);
+  CHECK_EQUAL(0, engine.add<S8_reg_co2>(sensor, slave, 5000));
+
+  engine.run_once(100);                             // Request sent, no answer
+  CHECK_EQUAL(S8_TRANSACTION_PENDING, sensor.transaction_status());
+
+  close(master);
+  uint32_t start = millis();
+  int calls = 0;
+  while (millis() - start < 300) {
+    engine.run_once(50);
+    calls++;
+  }
+
+  CHECK_EQUAL(1, finished);
+  CHECK_EQUAL(S8_TRANSACTION_ERROR, last_status);
+  CHECK_EQUAL(S8_TRANSACTION_ERROR, sensor.transaction_status());
+  CHECK_EQUAL(1, engine.errors);
+  CHECK_EQUAL(0, engine.timeouts);
+  CHECK(calls <= 10);                               // Sleeps in epoll_wait instead of waking at once
+
+  engine.end();
+  close(slave);
+}
+
+
+int main() {
+  test_hangup_ends_transaction();
+
+  return S8_TEST_RESULT();
+}
@@ -0,0 +1,128 @@
+/****************************************************************************
+   Unit tests of S8_filter (median window, EMA and Kalman in fixed point)
+ ****************************************************************************/
+
+#include "s8_filter.h"
+#include "s8_test.h"
+
+
+static void test_median_rejects_spike() {
+  S8_filter filter;
+
+  filter.set_ema(256);        // No smoothing, only the median
+  filter.add(400);
+  filter.add(400);
+  CHECK_EQUAL(400, filter.add(2000));
+  CHECK_EQUAL(401, filter.add(401));       // Median of 400, 2000, 401
+}
+
+
+static void test_median_refill_after_set_median() {
+  S8_filter filter;
+
+  filter.set_ema(256);
+  filter.add(400);
+  filter.add(410);
+  filter.add(420);
+
+  // Samples of the old window are forgotten
+  filter.set_median(5);
+  CHECK(!filter.primed());
+  CHECK_EQUAL(500, filter.add(500));
+  CHECK_EQUAL(510, filter.add(510));
+  CHECK_EQUAL(510, filter.add(520));
+  CHECK_EQUAL(520, filter.add(530));
+  CHECK_EQUAL(520, filter.add(540));
+  CHECK_EQUAL(530, filter.add(5000));       // Window is full, the oldest sample (500) leaves
+  CHECK_EQUAL(540, filter.add(5000));
+
+  // Smaller window than the samples received
+  filter.set_median(3);
+  CHECK_EQUAL(600, filter.add(600));
+  CHECK_EQUAL(600, filter.add(100));
+  CHECK_EQUAL(600, filter.add(700));
+  CHECK_EQUAL(700, filter.add(800));
+
+  // Out of range sizes
+  filter.set_median(0);
+  CHECK_EQUAL(900, filter.add(900));
+  CHECK_EQUAL(50, filter.add(50));
+  filter.set_median(S8_FILTER_MEDIAN_MAX + 5);
+  for (int i = 0; i < S8_FILTER_MEDIAN_MAX / 2; i++) {
+    filter.add(9000);
+  }
+  CHECK_EQUAL(9000, filter.add(400));
+  for (int i = 0; i < S8_FILTER_MEDIAN_MAX / 2; i++) {
+    filter.add(400);
+  }
+  CHECK_EQUAL(400, filter.value());
+  CHECK_EQUAL(400, filter.add(9000));       // Window of 7 samples, 4 of them are 400
+}
+
+
+static void test_kalman_variance_clamp() {
+  S8_filter filter;
+
+  // Huge process and measurement noise, the variance is limited and nothing overflows
+  filter.set_median(1);
+  filter.set_kalman(65535, 65535);
+  filter.add(400);
+  for (int i = 0; i < 1000; i++) {
+    int16_t v = filter.add((i & 1) ? 5000 : 400);
+    CHECK(v >= 400 && v <= 5000);
+  }
+
+  filter.reset();
+  filter.add(400);
+  for (int i = 0; i < 200; i++) {
+    filter.add(2000);
+  }
+  CHECK_EQUAL(2000, filter.value());
+
+  // Noise of the sensor much smaller than the changes, it follows at once
+  filter.set_kalman(65535, 1);
+  filter.reset();
+  filter.add(400);
+  int16_t v = filter.add(1000);
+  CHECK(v >= 995 && v <= 1000);
+
+  // No process noise, it converges to the mean
+  filter.set_kalman(0, 16);
+  filter.reset();
+  for (int i = 0; i < 100; i++) {
+    filter.add((i & 1) ? 410 : 390);
+  }
+  CHECK(filter.value() >= 399 && filter.value() <= 401);
+}
+
+
+static void test_rounding_of_negative_values() {
+  S8_filter filter;
+
+  filter.set_median(1);
+  filter.set_ema(128);
+
+  filter.add(0);
+  CHECK_EQUAL(2, filter.add(3));            // 1.5
+  filter.reset();
+  filter.add(0);
+  CHECK_EQUAL(-2, filter.add(-3));          // -1.5, same magnitude as 1.5
+  filter.reset();
+  filter.add(0);
+  CHECK_EQUAL(-1, filter.add(-1));          // -0.5
+  CHECK_EQUAL(-1, filter.add(-1));          // -0.75
+
+  filter.reset();
+  CHECK_EQUAL(-32768, filter.add(-32768));
+  CHECK_EQUAL(-1, filter.add(32767));       // -0.5, no overflow of the difference
+}
+
+
+int main() {
+  test_median_rejects_spike();
+  test_median_refill_after_set_median();
+  test_kalman_variance_clamp();
+  test_rounding_of_negative_values();
+
+  return S8_TEST_RESULT();
+}
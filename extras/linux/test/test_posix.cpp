@@ -0,0 +1,77 @@
+/****************************************************************************
+   Unit tests of S8_posix_transport (closed port)
+ ****************************************************************************/
+
+#include "s8_uart.h"
+#include "s8_transport_posix.h"
+#include "s8_test.h"
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+
+/* Pseudo-terminal, the master side plays the sensor */
+static int open_pty(int &slave) {
+  int master = posix_openpt(O_RDWR | O_NOCTTY);
+  CHECK(master >= 0 && grantpt(master) == 0 && unlockpt(master) == 0);
+  slave = open(ptsname(master), O_RDWR | O_NOCTTY);
+  CHECK(slave >= 0);
+  return master;
+}
+
+
+static void test_wait_reports_hangup() {
+  int slave;
+  int master = open_pty(slave);
+
+  S8_posix_transport transport(slave);
+  CHECK(transport.begin());
+  CHECK(!transport.wait(10));
+  CHECK(!transport.failed());
+
+  close(master);
+  uint32_t start = millis();
+  CHECK(!transport.wait(500));
+  CHECK(millis() - start < 100);
+  CHECK(transport.hangup());
+  CHECK(!transport.error());
+  CHECK(transport.failed());
+
+  close(slave);
+}
+
+
+static void test_read_stops_on_hangup() {
+  int slave;
+  int master = open_pty(slave);
+
+  S8_posix_transport transport(slave);
+  CHECK(transport.begin());
+  S8_UART sensor(transport);
+  sensor.set_timeout(500);
+
+  // Blocking path
+  close(master);
+  uint32_t start = millis();
+  CHECK_EQUAL(0, sensor.get_co2());
+  CHECK(millis() - start < 100);
+  CHECK_EQUAL(1, sensor.link_stats().errors);
+  CHECK_EQUAL(0, sensor.link_stats().timeouts);
+
+  // Non-blocking path
+  start = millis();
+  sensor.request_read<S8_reg_co2>();
+  CHECK_EQUAL(S8_TRANSACTION_ERROR, sensor.wait_transaction());
+  CHECK(millis() - start < 100);
+
+  close(slave);
+}
+
+
+int main() {
+  test_wait_reports_hangup();
+  test_read_stops_on_hangup();
+
+  return S8_TEST_RESULT();
+}
@@ -0,0 +1,127 @@
+/****************************************************************************
+   Unit tests of S8_scheduler (merge of reads due at the same time)
+ ****************************************************************************/
+
+#include "s8_scheduler.h"
+#include "s8_mock.h"
+#include "s8_test.h"
+
+
+static int16_t co2;
+static int16_t meter_status;
+static int16_t alarm_status;
+static int16_t pwm;
+static int32_t type_id;
+static uint8_t failures;
+
+static void on_co2(int8_t job, uint8_t status, const uint8_t *data) {
+  if (status != S8_TRANSACTION_DONE) { failures++; return; }
+  co2 = S8_reg_co2::decode(data);
+}
+
+static void on_meter_status(int8_t job, uint8_t status, const uint8_t *data) {
+  if (status != S8_TRANSACTION_DONE) { failures++; return; }
+  meter_status = S8_reg_meter_status::decode(data);
+}
+
+static void on_alarm_status(int8_t job, uint8_t status, const uint8_t *data) {
+  if (status != S8_TRANSACTION_DONE) { failures++; return; }
+  alarm_status = S8_reg_alarm_status::decode(data);
+}
+
+static void on_pwm(int8_t job, uint8_t status, const uint8_t *data) {
+  if (status != S8_TRANSACTION_DONE) { failures++; return; }
+  pwm = S8_reg_pwm_output::decode(data);
+}
+
+static void on_type_id(int8_t job, uint8_t status, const uint8_t *data) {
+  if (status != S8_TRANSACTION_DONE) { failures++; return; }
+  type_id = S8_reg_sensor_type_id::decode(data);
+}
+
+
+/* Run until all jobs are done or 1 second */
+static void run(S8_scheduler &scheduler, uint32_t jobs) {
+  uint32_t start = millis();
+
+  while (scheduler.jobs_done < jobs && (millis() - start) < 1000) {
+    scheduler.tick();
+  }
+}
+
+
+/* Mock that does not answer reserved registers, like the sensor */
+static bool reserved_read;
+
+class S8_strict_transport : public S8_mock_transport
+{
+  public:
+    S8_strict_transport(S8_mock_device &device) : S8_mock_transport(device) {}
+
+    uint8_t write(const uint8_t *buf, uint8_t size) override {
+      uint16_t reg = (buf[2] << 8) | buf[3];
+      uint16_t words = (buf[4] << 8) | buf[5];
+      if (buf[1] == MODBUS_FUNC_READ_INPUT_REGISTERS && reg < MODBUS_IR26 && reg + words > MODBUS_IR22 + 1) {
+        reserved_read = true;
+        S8_mock_transport::write(buf, 0);     // No answer
+        return size;
+      }
+      return S8_mock_transport::write(buf, size);
+    }
+};
+
+
+static void test_no_merge_across_gap() {
+  S8_mock_device device;
+  S8_strict_transport transport(device);
+  S8_UART sensor(transport);
+  S8_scheduler scheduler(sensor);
+
+  sensor.set_timeout(50);
+  failures = 0;
+  reserved_read = false;
+  scheduler.add_read<S8_reg_pwm_output>(0, on_pwm);
+  scheduler.add_read<S8_reg_sensor_type_id>(0, on_type_id);
+  run(scheduler, 2);
+
+  CHECK_EQUAL(2, scheduler.jobs_done);
+  CHECK_EQUAL(2, scheduler.transactions);                 // IR22 and IR26-IR27 are not merged
+  CHECK(!reserved_read);
+  CHECK_EQUAL(0, failures);
+  CHECK_EQUAL(3277, pwm);
+  CHECK_EQUAL(0x10203, type_id);
+}
+
+
+static void test_merge_adjacent() {
+  S8_mock_device device;
+  S8_mock_transport transport(device);
+  S8_UART sensor(transport);
+  S8_scheduler scheduler(sensor);
+
+  failures = 0;
+  device.input_regs[MODBUS_IR1] = 0x0020;
+  device.input_regs[MODBUS_IR2] = 0x0001;
+  device.input_regs[MODBUS_IR4] = 812;
+
+  // IR1 and IR4 are not adjacent, IR2 fills part of the gap and IR3 is not read by any job
+  scheduler.add_read<S8_reg_meter_status>(0, on_meter_status);
+  scheduler.add_read<S8_reg_co2>(0, on_co2);
+  scheduler.add_read<S8_reg_alarm_status>(0, on_alarm_status);
+  run(scheduler, 3);
+
+  CHECK_EQUAL(3, scheduler.jobs_done);
+  CHECK_EQUAL(2, scheduler.transactions);                 // IR1-IR2 merged, IR4 alone
+  CHECK_EQUAL(0, failures);
+  CHECK_EQUAL(0x20, meter_status);
+  CHECK_EQUAL(1, alarm_status);
+  CHECK_EQUAL(812, co2);
+}
+
+
+int main() {
+  test_no_merge_across_gap();
+  test_merge_adjacent();
+
+  return S8_TEST_RESULT();
+}
@@ -0,0 +1,104 @@
+/****************************************************************************
+   Unit tests of S8_telemetry (batches bigger than 255 samples, escape of names)
+ ****************************************************************************/
+
+#include <string.h>
+#include <vector>
+#include "s8_telemetry.h"
+#include "s8_test.h"
+
+
+static std::vector<char> last_batch;
+static uint32_t batches;
+
+static void on_batch(const char *payload, size_t len) {
+  last_batch.assign(payload, payload + len);
+  last_batch.push_back('\0');
+  batches++;
+}
+
+
+static size_t occurrences(const char *text, char c) {
+  size_t n = 0;
+  for (; *text; text++) {
+    n += (*text == c);
+  }
+  return n;
+}
+
+
+static void test_json_many_samples() {
+  static char buf[65536];
+  S8_telemetry telemetry(buf, sizeof(buf), S8_TELEMETRY_JSON);
+  S8_sensor sensor;
+
+  memset(&sensor, 0, sizeof(sensor));
+  sensor.co2 = 650;
+  batches = 0;
+  telemetry.on_batch(on_batch);
+
+  for (int i = 0; i < 300; i++) {
+    CHECK(telemetry.add("a", sensor, 1000 + i));
+  }
+  CHECK_EQUAL(300, telemetry.samples());
+  CHECK_EQUAL(0, batches);
+
+  telemetry.flush();
+  CHECK_EQUAL(1, batches);
+
+  const char *text = &last_batch[0];
+  CHECK_EQUAL('[', text[0]);
+  CHECK_EQUAL(1, occurrences(text, '['));                 // Only one array
+  CHECK_EQUAL(1, occurrences(text, ']'));
+  CHECK_EQUAL(300, occurrences(text, '{'));
+  CHECK_EQUAL(300, occurrences(text, '}'));
+}
+
+
+static void test_line_protocol_many_samples() {
+  static char buf[65536];
+  S8_telemetry telemetry(buf, sizeof(buf));
+  S8_sensor sensor;
+
+  memset(&sensor, 0, sizeof(sensor));
+  sensor.co2 = 650;
+  batches = 0;
+  telemetry.on_batch(on_batch);
+
+  for (int i = 0; i < 600; i++) {
+    telemetry.add("a", sensor, 1000 + i);
+  }
+  telemetry.flush();
+
+  CHECK_EQUAL(1, batches);
+  CHECK_EQUAL(600, occurrences(&last_batch[0], '\n'));
+}
+
+
+static void test_line_protocol_escape() {
+  static char buf[1024];
+  S8_telemetry telemetry(buf, sizeof(buf));
+  S8_sensor sensor;
+
+  memset(&sensor, 0, sizeof(sensor));
+  sensor.co2 = 400;
+  telemetry.on_batch(on_batch);
+  telemetry.set_measurement("co2 room,1");
+
+  CHECK(telemetry.add("a,b=c d\\e\nf", sensor, 1000));
+  telemetry.flush();
+
+  const char *expected = "co2\\ room\\,1,sensor=a\\,b\\=c\\ d\\\\ef co2=400i,meter_status=0i,alarm_status=0i,output_status=0i 1000\n";
+  CHECK(strcmp(expected, &last_batch[0]) == 0);
+  CHECK_EQUAL(1, occurrences(&last_batch[0], '\n'));       // One line per sample
+}
+
+
+int main() {
+  test_json_many_samples();
+  test_line_protocol_many_samples();
+
+  test_line_protocol_escape();
+
+  return S8_TEST_RESULT();
+}
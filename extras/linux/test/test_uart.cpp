@@ -0,0 +1,212 @@
+/****************************************************************************
+   Unit tests of S8_UART framing (resync, exception responses, probe)
+ ****************************************************************************/
+
+#include "s8_uart.h"
+#include "s8_mock.h"
+#include "modbus_crc.h"
+#include "s8_test.h"
+
+#include <string.h>
+
+
+/* Mock with extra bytes around the answer, an exception instead of it, or only garbage */
+class S8_noisy_transport : public S8_mock_transport
+{
+  public:
+    S8_noisy_transport(S8_mock_device &device) : S8_mock_transport(device), prefix_len(0), suffix_len(0),
+      exception(false), answer(true), chunk(255), len(0), pos(0) {}
+
+    uint8_t prefix[16];         // Bytes before the answer
+    uint8_t prefix_len;
+    uint8_t suffix[16];         // Bytes after the answer
+    uint8_t suffix_len;
+    bool exception;             // Answer with an exception (illegal data address)
+    bool answer;                // false: only prefix and suffix are sent
+    uint8_t chunk;              // Max bytes returned by a read
+
+    /* Bytes received before the next request */
+    void inject(const uint8_t *buf, uint8_t size) {
+      memcpy(&rx[len], buf, size);
+      len += size;
+    }
+
+    uint8_t write(const uint8_t *buf, uint8_t size) override {
+      uint8_t frame[S8_MOCK_LEN_FRAME];
+      uint8_t nb = 0;
+
+      S8_mock_transport::write(buf, size);
+      if (answer && exception) {
+        frame[nb++] = buf[0];
+        frame[nb++] = buf[1] | 0x80;
+        frame[nb++] = 0x02;
+        uint16_t crc16 = modbus_CRC16(frame, 3);
+        frame[nb++] = crc16 & 0x00FF;
+        frame[nb++] = (crc16 >> 8) & 0x00FF;
+      } else if (answer) {
+        nb = S8_mock_transport::read(frame, sizeof(frame));
+      }
+
+      len = 0;
+      pos = 0;
+      inject(prefix, prefix_len);
+      inject(frame, nb);
+      inject(suffix, suffix_len);
+      return size;
+    }
+
+    int available() override { return len - pos; }
+
+    uint8_t read(uint8_t *buf, uint8_t max_bytes) override {
+      uint8_t nb = 0;
+      while (nb < max_bytes && nb < chunk && pos < len) {
+        buf[nb++] = rx[pos++];
+      }
+      return nb;
+    }
+
+  private:
+    uint8_t rx[2 * S8_MOCK_LEN_FRAME];
+    uint8_t len;
+    uint8_t pos;
+};
+
+
+static const uint8_t garbage[] = { 0x55, 0xFE, 0x00, 0xAA, 0xFE, 0x04, 0x09 };
+
+
+static void test_probe_garbage_only() {
+  S8_mock_device device;
+  S8_noisy_transport transport(device);
+  S8_UART sensor(transport);
+
+  transport.answer = false;
+  memcpy(transport.prefix, garbage, sizeof(garbage));
+  transport.prefix_len = sizeof(garbage);
+
+  CHECK_EQUAL(S8_PROBE_NOISE, sensor.probe(20));
+  CHECK(sensor.link_stats().discarded_bytes > 0);
+
+  transport.prefix_len = 0;
+  CHECK_EQUAL(S8_PROBE_SILENT, sensor.probe(20));
+
+  transport.answer = true;
+  CHECK_EQUAL(S8_PROBE_FOUND, sensor.probe(20));
+}
+
+
+static void test_garbage_before_response() {
+  S8_mock_device device;
+  S8_noisy_transport transport(device);
+  S8_UART sensor(transport);
+
+  memcpy(transport.prefix, garbage, sizeof(garbage));
+  transport.prefix_len = sizeof(garbage);
+
+  CHECK_EQUAL(400, sensor.get_co2());
+  CHECK_EQUAL(sizeof(garbage), sensor.link_stats().discarded_bytes);
+  CHECK_EQUAL(1, sensor.link_stats().resyncs);
+  CHECK_EQUAL(0, sensor.link_stats().errors);
+}
+
+
+static void test_stale_bytes_before_request() {
+  S8_mock_device device;
+  S8_noisy_transport transport(device);
+  S8_UART sensor(transport);
+
+  // Late answer of a previous request left in the port
+  uint8_t late[] = { 0xFE, 0x04, 0x02, 0x01, 0x90, 0x00, 0x00 };
+  transport.inject(late, sizeof(late));
+
+  CHECK_EQUAL(400, sensor.get_co2());
+  CHECK_EQUAL(sizeof(late), sensor.link_stats().discarded_bytes);
+  CHECK_EQUAL(0, sensor.link_stats().resyncs);
+}
+
+
+static void test_trailing_bytes() {
+  S8_mock_device device;
+  S8_noisy_transport transport(device);
+  S8_UART sensor(transport);
+
+  memcpy(transport.suffix, garbage, sizeof(garbage));
+  transport.suffix_len = sizeof(garbage);
+
+  CHECK_EQUAL(400, sensor.get_co2());
+  device.input_regs[MODBUS_IR4] = 800;
+  CHECK_EQUAL(800, sensor.get_co2());        // Bytes after the first response are discarded before the second request
+  CHECK_EQUAL(sizeof(garbage), sensor.link_stats().discarded_bytes);
+  CHECK_EQUAL(0, sensor.link_stats().errors);
+}
+
+
+static void test_exception_does_not_wait_timeout() {
+  S8_mock_device device;
+  S8_noisy_transport transport(device);
+  S8_UART sensor(transport);
+
+  transport.exception = true;
+  sensor.set_timeout(500);
+
+  uint32_t start = millis();
+  CHECK_EQUAL(0, sensor.get_co2());
+  CHECK(millis() - start < 100);
+  CHECK_EQUAL(1, sensor.link_stats().errors);
+  CHECK_EQUAL(0, sensor.link_stats().timeouts);
+}
+
+
+static void test_nonblocking_resync() {
+  S8_mock_device device;
+  S8_noisy_transport transport(device);
+  S8_UART sensor(transport);
+
+  memcpy(transport.prefix, garbage, sizeof(garbage));
+  transport.prefix_len = sizeof(garbage);
+  transport.chunk = 3;
+
+  CHECK(sensor.request_read<S8_reg_co2>());
+  uint32_t start = millis();
+  while (sensor.poll_transaction() == S8_TRANSACTION_PENDING && (millis() - start) < 100) {
+  }
+  CHECK_EQUAL(S8_TRANSACTION_DONE, sensor.transaction_status());
+  CHECK_EQUAL(400, sensor.response_value<S8_reg_co2>());
+  CHECK_EQUAL(sizeof(garbage), sensor.link_stats().discarded_bytes);
+
+  // Exception response, also in pieces
+  transport.prefix_len = 0;
+  transport.exception = true;
+  CHECK(sensor.request_read<S8_reg_co2>());
+  CHECK_EQUAL(S8_TRANSACTION_ERROR, sensor.wait_transaction());
+}
+
+
+static void test_write_echo() {
+  S8_mock_device device;
+  S8_noisy_transport transport(device);
+  S8_UART sensor(transport);
+
+  memcpy(transport.prefix, garbage, sizeof(garbage));
+  transport.prefix_len = sizeof(garbage);
+
+  CHECK(sensor.set_ABC_period(24));
+  CHECK_EQUAL(24, device.holding_regs[MODBUS_HR32]);
+  CHECK_EQUAL(sizeof(garbage), sensor.link_stats().discarded_bytes);
+
+  transport.exception = true;
+  CHECK(!sensor.set_ABC_period(48));
+}
+
+
+int main() {
+  test_probe_garbage_only();
+  test_garbage_before_response();
+  test_stale_bytes_before_request();
+  test_trailing_bytes();
+  test_exception_does_not_wait_timeout();
+  test_nonblocking_resync();
+  test_write_echo();
+
+  return S8_TEST_RESULT();
+}
@@ -0,0 +1,165 @@
+/***************************************************************************************************************************
+
+	SenseAir S8 Anomaly Detector
+
+	Copyright (c) 2021 Josep Comas
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+	SOFTWARE.
+
+***************************************************************************************************************************/
+
+
+
+#include "s8_anomaly.h"
+
+
+S8_anomaly::S8_anomaly() {
+    callback_change = NULL;
+    flatline_ms = S8_ANOMALY_FLATLINE_TIME;
+    flatline_tolerance = 0;
+    max_rate = S8_ANOMALY_MAX_RATE;
+    min_co2 = S8_ANOMALY_MIN_CO2;
+    max_co2 = S8_ANOMALY_MAX_CO2;
+    pwm_full_scale = S8_ANOMALY_PWM_FULL_SCALE;
+    pwm_tolerance = S8_ANOMALY_PWM_TOLERANCE;
+    events = 0;
+    reset();
+}
+
+
+void S8_anomaly::set_flatline(uint32_t time_ms, uint16_t tolerance) {
+    flatline_ms = time_ms;
+    flatline_tolerance = tolerance;
+}
+
+
+void S8_anomaly::set_max_rate(uint16_t ppm_per_second) {
+    max_rate = ppm_per_second;
+}
+
+
+void S8_anomaly::set_range(int16_t min_co2, int16_t max_co2) {
+    this->min_co2 = min_co2;
+    this->max_co2 = max_co2;
+}
+
+
+void S8_anomaly::set_pwm(uint16_t full_scale, uint16_t tolerance) {
+    pwm_full_scale = full_scale;
+    pwm_tolerance = tolerance;
+}
+
+
+void S8_anomaly::reset() {
+    flags = 0;
+    have_value = false;
+}
+
+
+/* Check a new reading */
+uint8_t S8_anomaly::add(uint32_t now, int16_t co2, int16_t meter_status) {
+
+    uint8_t found = 0;
+
+    // Range, cross-checked with the flag of the sensor
+    bool out_value = (co2 < min_co2 || co2 > max_co2);
+    bool out_flag = (meter_status & S8_MASK_METER_OUT_OF_RANGE) != 0;
+
+    if (out_value || out_flag) {
+        found |= S8_ANOMALY_RANGE;
+    }
+    if (out_value != out_flag) {
+        found |= S8_ANOMALY_STATUS;
+    }
+
+    if (have_value) {
+        uint32_t elapsed = now - last_time;
+        int32_t change = (int32_t)co2 - last_co2;
+        if (change < 0) {
+            change = -change;
+        }
+
+        // Rate of change (ppm/s), only between close readings
+        if (elapsed > 0 && elapsed <= S8_ANOMALY_RATE_WINDOW && (uint32_t)change * 1000 > (uint32_t)max_rate * elapsed) {
+            found |= S8_ANOMALY_RATE;
+        }
+
+        // Flat value, a real sensor always has some noise
+        int32_t drift = (int32_t)co2 - flat_co2;
+        if (drift > flatline_tolerance || drift < -(int32_t)flatline_tolerance) {
+            flat_co2 = co2;
+            flat_since = now;
+        } else if ((now - flat_since) >= flatline_ms) {
+            found |= S8_ANOMALY_FLATLINE;
+        }
+
+    } else {
+        flat_co2 = co2;
+        flat_since = now;
+        have_value = true;
+    }
+
+    last_co2 = co2;
+    last_time = now;
+
+    update(S8_ANOMALY_FLATLINE | S8_ANOMALY_RATE | S8_ANOMALY_RANGE | S8_ANOMALY_STATUS, found);
+    return flags;
+}
+
+
+/* Compare PWM output with the last CO2 value (PWM saturates at full scale) */
+uint8_t S8_anomaly::add_pwm(int16_t pwm) {
+
+    if (!have_value) {
+        return flags;
+    }
+
+    int32_t pwm_co2 = ((int32_t)pwm * pwm_full_scale) / S8_ANOMALY_PWM_RAW_MAX;
+    int32_t co2 = last_co2;
+
+    if (co2 < 0) {
+        co2 = 0;
+    } else if (co2 > pwm_full_scale) {
+        co2 = pwm_full_scale;
+    }
+
+    int32_t diff = pwm_co2 - co2;
+    update(S8_ANOMALY_PWM, (diff > pwm_tolerance || diff < -(int32_t)pwm_tolerance) ? S8_ANOMALY_PWM : 0);
+
+    return flags;
+}
+
+
+/* Replace the flags of mask, count new anomalies and notify changes */
+void S8_anomaly::update(uint8_t mask, uint8_t new_flags) {
+
+    uint8_t old = flags;
+
+    flags = (flags & ~mask) | new_flags;
+
+    if (flags != old) {
+        if (flags & ~old) {
+            events++;
+            LOG_DEBUG_WARN("Anomaly detected: ", flags);
+        }
+        if (callback_change != NULL) {
+            callback_change(flags);
+        }
+    }
+}
@@ -0,0 +1,100 @@
+/***************************************************************************************************************************
+
+	SenseAir S8 Anomaly Detector
+
+	Copyright (c) 2021 Josep Comas
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+	SOFTWARE.
+
+***************************************************************************************************************************/
+
+
+
+#ifndef _S8_ANOMALY_H
+    #define _S8_ANOMALY_H
+
+    #include "s8_uart.h"
+
+
+    #define S8_ANOMALY_FLATLINE_TIME    3600000ul   // Time with the same value to consider the sensor stuck (1 hour)
+    #define S8_ANOMALY_MAX_RATE         100         // Max change of CO2 in ppm per second
+    #define S8_ANOMALY_RATE_WINDOW      60000ul     // Max time between readings to check the rate of change
+    #define S8_ANOMALY_MIN_CO2          0           // Range of the sensor in ppm
+    #define S8_ANOMALY_MAX_CO2          10000
+    #define S8_ANOMALY_PWM_FULL_SCALE   2000        // CO2 at 100 % of PWM output in ppm (normal version)
+    #define S8_ANOMALY_PWM_TOLERANCE    50          // Max difference between PWM output and CO2 in ppm
+    #define S8_ANOMALY_PWM_RAW_MAX      16383       // Raw value of IR22 at 100 % of PWM output
+
+
+    // Anomalies (flags)
+    #define S8_ANOMALY_FLATLINE         0x01        // Same value for too long
+    #define S8_ANOMALY_RATE             0x02        // Impossible rate of change
+    #define S8_ANOMALY_RANGE            0x04        // Value out of range or out of range flag in meter status
+    #define S8_ANOMALY_STATUS           0x08        // Out of range flag disagrees with the value
+    #define S8_ANOMALY_PWM              0x10        // PWM output disagrees with the CO2 value of Modbus
+
+
+    typedef void (*S8_anomaly_callback)(uint8_t flags);                             // Anomalies changed (S8_ANOMALY_xxx)
+
+
+    /*
+        Online detector of a stuck or faulty sensor, fed with every reading (S8_sampler::set_anomaly does it)
+
+        It keeps a few values per sensor (constant memory, no history): start of the current flat value, last
+        value and time, and the flags of the last readings. A flag is cleared by the next reading without it.
+    */
+    class S8_anomaly
+    {
+        public:
+            S8_anomaly();
+
+            void set_flatline(uint32_t time_ms, uint16_t tolerance = 0);            // Time with the value inside +/- tolerance ppm
+            void set_max_rate(uint16_t ppm_per_second);
+            void set_range(int16_t min_co2, int16_t max_co2);
+            void set_pwm(uint16_t full_scale, uint16_t tolerance);                  // CO2 at 100 % of PWM and max difference (ppm)
+            void on_change(S8_anomaly_callback callback) { callback_change = callback; }
+            void reset();                                                           // Forget readings (ex: sensor replaced)
+
+            uint8_t add(uint32_t now, int16_t co2, int16_t meter_status);           // New reading (returns flags)
+            uint8_t add_pwm(int16_t pwm);                                           // PWM output (raw IR22) of the last reading (returns flags)
+
+            uint8_t flags;                                                          // Current anomalies (S8_ANOMALY_xxx)
+            uint32_t events;                                                        // Times a new anomaly was detected
+
+        private:
+            S8_anomaly_callback callback_change;
+
+            uint32_t flatline_ms;
+            uint16_t flatline_tolerance;
+            uint16_t max_rate;
+            int16_t min_co2;
+            int16_t max_co2;
+            uint16_t pwm_full_scale;
+            uint16_t pwm_tolerance;
+
+            bool have_value;
+            int16_t last_co2;
+            uint32_t last_time;
+            int16_t flat_co2;                                                       // Value at start of the flat period
+            uint32_t flat_since;
+
+            void update(uint8_t mask, uint8_t new_flags);
+    };
+
+#endif
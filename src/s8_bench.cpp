@@ -0,0 +1,243 @@
+/***************************************************************************************************************************
+
+	SenseAir S8 Micro-benchmarks
+
+	Copyright (c) 2021 Josep Comas
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+	SOFTWARE.
+
+***************************************************************************************************************************/
+
+
+
+#include "s8_bench.h"
+#include "s8_mock.h"
+#include "modbus_crc.h"
+
+
+#define S8_BENCH_MAX_REPEATS  15
+
+
+static volatile uint32_t bench_sink;    // Results go here, so the compiler can't remove the work
+
+
+/* Transport that always answers the same response, without processing the request */
+class S8_bench_transport : public S8_transport
+{
+    public:
+        S8_bench_transport() : len(0), pos(0) {}
+
+        void set_response(const uint8_t *data, uint8_t size) { memcpy(response, data, size); len = size; }
+
+        uint8_t write(const uint8_t *, uint8_t size) override { pos = 0; return size; }
+        void flush() override {}
+        int available() override { return len - pos; }
+        uint8_t read(uint8_t *buf, uint8_t max_bytes) override {
+            uint8_t n = (len - pos < max_bytes) ? len - pos : max_bytes;
+            memcpy(buf, &response[pos], n);
+            pos += n;
+            return n;
+        }
+
+    private:
+        uint8_t response[S8_LEN_BUF_MSG];
+        uint8_t len;
+        uint8_t pos;
+};
+
+
+/* Driver giving access to the frame building (protected in S8_UART) */
+class S8_bench_uart : public S8_UART
+{
+    public:
+        S8_bench_uart(S8_transport &transport) : S8_UART(transport) {}
+
+        uint8_t build_request(uint8_t func, uint16_t reg, uint16_t words) { build_cmd(func, reg, words); return buf_msg[7]; }
+};
+
+
+typedef S8_block<S8_reg_meter_status, S8_reg_co2> bench_block;
+
+static uint8_t bench_request[8] = { 0xFE, 0x04, 0x00, 0x00, 0x00, 0x04, 0x00, 0x00 };
+static uint8_t bench_response[13] = { 0xFE, 0x04, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x90, 0x00, 0x00 };
+
+static S8_bench_uart *bench_sensor;
+static S8_UART *bench_mock_sensor;
+
+
+static void bench_crc_request(uint32_t iterations) {
+    uint32_t sum = 0;
+    while (iterations--) {
+        sum += modbus_CRC16(bench_request, 6);
+    }
+    bench_sink = sum;
+}
+
+
+static void bench_crc_response(uint32_t iterations) {
+    uint32_t sum = 0;
+    while (iterations--) {
+        sum += modbus_CRC16(bench_response, 11);
+    }
+    bench_sink = sum;
+}
+
+
+/* Only the frame (address, function, register, words and CRC), without transport or transaction state */
+static void bench_build_cmd(uint32_t iterations) {
+    uint32_t sum = 0;
+    while (iterations--) {
+        sum += bench_sensor->build_request(bench_block::func, bench_block::addr + (iterations & 1), bench_block::words);
+    }
+    bench_sink = sum;
+}
+
+
+static void bench_request_response(uint32_t iterations) {
+    uint32_t sum = 0;
+    while (iterations--) {
+        bench_sensor->request_read<bench_block>();
+        sum += bench_sensor->poll_transaction();
+    }
+    bench_sink = sum;
+}
+
+
+static void bench_decode_block(uint32_t iterations) {
+    uint32_t sum = 0;
+    while (iterations--) {
+        const uint8_t *data = (const uint8_t *)&bench_response[3 + (iterations & 1)];     // Not a constant for the compiler
+        sum += bench_block::decode<S8_reg_meter_status>(data) + bench_block::decode<S8_reg_alarm_status>(data) +
+               bench_block::decode<S8_reg_output_status>(data) + bench_block::decode<S8_reg_co2>(data);
+    }
+    bench_sink = sum;
+}
+
+
+static void bench_mock_transaction(uint32_t iterations) {
+    uint32_t sum = 0;
+    while (iterations--) {
+        sum += bench_mock_sensor->get_co2();
+    }
+    bench_sink = sum;
+}
+
+
+S8_bench::S8_bench() {
+    repeats = S8_BENCH_REPEATS;
+    sample_us = S8_BENCH_SAMPLE_US;
+}
+
+
+/* Measure a function: find iterations for a sample of sample_us, then median of samples */
+S8_bench_result S8_bench::measure(const char *name, S8_bench_function function) {
+
+    S8_bench_result result;
+    float ns[S8_BENCH_MAX_REPEATS];
+    float cycles[S8_BENCH_MAX_REPEATS];
+    uint8_t n = (repeats == 0) ? 1 : (repeats > S8_BENCH_MAX_REPEATS ? S8_BENCH_MAX_REPEATS : repeats);
+    uint32_t iterations = 1;
+
+    // Calibration (it also warms caches)
+    while (true) {
+        uint32_t start = micros();
+        function(iterations);
+        uint32_t elapsed = micros() - start;
+
+        if (elapsed >= sample_us / 4 || iterations >= 0x10000000ul) {
+            if (elapsed > 0 && elapsed < sample_us) {
+                iterations = (uint32_t)((uint64_t)iterations * sample_us / elapsed);
+            }
+            break;
+        }
+        iterations *= 4;
+    }
+
+    for (uint8_t i = 0; i < n; i++) {
+    #ifdef S8_BENCH_CYCLES
+        uint32_t start_cycles = S8_BENCH_CYCLES();
+    #endif
+        uint32_t start = micros();
+        function(iterations);
+        uint32_t elapsed = micros() - start;
+    #ifdef S8_BENCH_CYCLES
+        cycles[i] = (float)(uint32_t)(S8_BENCH_CYCLES() - start_cycles) / iterations;
+    #else
+        cycles[i] = 0;
+    #endif
+        ns[i] = elapsed * 1000.0f / iterations;
+    }
+
+    // Median (insertion sort, few samples)
+    for (uint8_t i = 1; i < n; i++) {
+        for (uint8_t j = i; j > 0 && ns[j] < ns[j - 1]; j--) {
+            float t = ns[j]; ns[j] = ns[j - 1]; ns[j - 1] = t;
+        }
+        for (uint8_t j = i; j > 0 && cycles[j] < cycles[j - 1]; j--) {
+            float t = cycles[j]; cycles[j] = cycles[j - 1]; cycles[j - 1] = t;
+        }
+    }
+
+    result.name = name;
+    result.iterations = iterations;
+    result.ns_per_op = ns[n / 2];
+    result.cycles_per_op = cycles[n / 2];
+
+    return result;
+}
+
+
+/* Run all cases */
+uint8_t S8_bench::run(S8_bench_result results[], uint8_t max_results) {
+
+    static const struct { const char *name; S8_bench_function function; } cases[S8_BENCH_CASES] = {
+        { "crc16_request", bench_crc_request },
+        { "crc16_response", bench_crc_response },
+        { "build_cmd", bench_build_cmd },
+        { "request_response", bench_request_response },
+        { "decode_block", bench_decode_block },
+        { "mock_transaction", bench_mock_transaction }
+    };
+
+    // Valid frames
+    uint16_t crc16 = modbus_CRC16(bench_request, 6);
+    bench_request[6] = crc16 & 0x00FF;
+    bench_request[7] = (crc16 >> 8) & 0x00FF;
+    crc16 = modbus_CRC16(bench_response, 11);
+    bench_response[11] = crc16 & 0x00FF;
+    bench_response[12] = (crc16 >> 8) & 0x00FF;
+
+    // Sensors without serial port
+    S8_mock_device device;
+    S8_mock_transport mock(device);
+    S8_bench_transport transport;
+    transport.set_response(bench_response, sizeof(bench_response));
+    S8_bench_uart sensor(transport);
+    S8_UART mock_sensor(mock);
+
+    bench_sensor = &sensor;
+    bench_mock_sensor = &mock_sensor;
+
+    uint8_t count = 0;
+    for (uint8_t i = 0; i < S8_BENCH_CASES && count < max_results; i++) {
+        results[count++] = measure(cases[i].name, cases[i].function);
+    }
+
+    return count;
+}
@@ -0,0 +1,79 @@
+/***************************************************************************************************************************
+
+	SenseAir S8 Micro-benchmarks
+
+	Copyright (c) 2021 Josep Comas
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+	SOFTWARE.
+
+***************************************************************************************************************************/
+
+
+
+#ifndef _S8_BENCH_H
+    #define _S8_BENCH_H
+
+    #include "s8_uart.h"
+
+
+    #define S8_BENCH_CASES          6           // Cases of S8_bench::run
+    #define S8_BENCH_REPEATS        5           // Samples per case (median is reported)
+    #define S8_BENCH_SAMPLE_US  20000ul         // Min time of a sample
+
+    #if defined(ARDUINO_ARCH_ESP32)
+        #define S8_BENCH_CYCLES()   ESP.getCycleCount()
+    #elif defined(ARDUINO_ARCH_RP2040)
+        #define S8_BENCH_CYCLES()   rp2040.getCycleCount()
+    #endif
+
+
+    /* Result of a case */
+    struct S8_bench_result {
+        const char *name;
+        uint32_t iterations;                // Iterations of a sample
+        float ns_per_op;                    // Median of samples
+        float cycles_per_op;                // Median of samples (0 if there is no cycle counter)
+    };
+
+
+    /*
+        Micro-benchmarks of the hot paths of the protocol, without serial port: CRC of a request and of a response,
+        build of the frame of a request, request + validation of a response, decoding of a block and a full transaction with the
+        mock device. Every case runs enough iterations to last S8_BENCH_SAMPLE_US, S8_BENCH_REPEATS times, and the
+        median is reported (stable against interrupts and scheduling).
+    */
+    class S8_bench
+    {
+        public:
+            S8_bench();
+
+            void set_repeats(uint8_t repeats) { this->repeats = repeats; }
+            void set_sample_time(uint32_t sample_us) { this->sample_us = sample_us; }
+
+            uint8_t run(S8_bench_result results[], uint8_t max_results);           // Run all cases (returns number of results)
+
+            typedef void (*S8_bench_function)(uint32_t iterations);
+            S8_bench_result measure(const char *name, S8_bench_function function); // Measure a function (iterations given as argument)
+
+        private:
+            uint8_t repeats;
+            uint32_t sample_us;
+    };
+
+#endif
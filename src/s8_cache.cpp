@@ -0,0 +1,132 @@
+/***************************************************************************************************************************
+
+	SenseAir S8 Register Cache
+
+	Copyright (c) 2021 Josep Comas
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+	SOFTWARE.
+
+***************************************************************************************************************************/
+
+
+#include "s8_cache.h"
+#include "utils.h"
+
+
+S8_cache::S8_cache() {
+    static const struct { uint8_t func; uint16_t addr; uint32_t ttl_ms; } registers[S8_CACHE_ENTRIES] = {
+        { S8_reg_meter_status::func, S8_reg_meter_status::addr, S8_CACHE_TTL_SHORT },
+        { S8_reg_alarm_status::func, S8_reg_alarm_status::addr, S8_CACHE_TTL_SHORT },
+        { S8_reg_output_status::func, S8_reg_output_status::addr, S8_CACHE_TTL_SHORT },
+        { S8_reg_co2::func, S8_reg_co2::addr, S8_CACHE_TTL_SHORT },
+        { S8_reg_pwm_output::func, S8_reg_pwm_output::addr, S8_CACHE_TTL_SHORT },
+        { S8_reg_sensor_type_id::func, S8_reg_sensor_type_id::addr, S8_CACHE_TTL_FOREVER },
+        { S8_reg_memory_map_version::func, S8_reg_memory_map_version::addr, S8_CACHE_TTL_FOREVER },
+        { S8_reg_firmware_version::func, S8_reg_firmware_version::addr, S8_CACHE_TTL_FOREVER },
+        { S8_reg_sensor_id::func, S8_reg_sensor_id::addr, S8_CACHE_TTL_FOREVER },
+        { S8_reg_acknowledgement::func, S8_reg_acknowledgement::addr, S8_CACHE_TTL_SHORT },
+        { S8_reg_abc_period::func, S8_reg_abc_period::addr, S8_CACHE_TTL_FOREVER }
+    };
+
+    for (uint8_t i = 0; i < S8_CACHE_ENTRIES; i++) {
+        entries[i].func = registers[i].func;
+        entries[i].addr = registers[i].addr;
+        entries[i].ttl_ms = registers[i].ttl_ms;
+        entries[i].valid = false;
+    }
+
+    hits = 0;
+    misses = 0;
+}
+
+
+S8_cache::Entry *S8_cache::find(uint8_t func, uint16_t addr) {
+    for (uint8_t i = 0; i < S8_CACHE_ENTRIES; i++) {
+        if (entries[i].addr == addr && entries[i].func == func) {
+            return &entries[i];
+        }
+    }
+
+    return NULL;
+}
+
+
+void S8_cache::set_ttl(uint8_t func, uint16_t addr, uint32_t ttl_ms) {
+    Entry *entry = find(func, addr);
+
+    if (entry != NULL) {
+        entry->ttl_ms = ttl_ms;
+    }
+}
+
+
+bool S8_cache::get(uint8_t func, uint16_t addr, int32_t &value) {
+    Entry *entry = find(func, addr);
+
+    if (entry == NULL) {
+        return false;
+    }
+
+    if (entry->valid && (entry->ttl_ms == S8_CACHE_TTL_FOREVER || (millis() - entry->time) < entry->ttl_ms)) {
+        value = entry->value;
+        hits++;
+        return true;
+    }
+
+    misses++;
+    return false;
+}
+
+
+void S8_cache::put(uint8_t func, uint16_t addr, int32_t value) {
+    Entry *entry = find(func, addr);
+
+    if (entry != NULL && entry->ttl_ms > 0) {
+        entry->value = value;
+        entry->time = millis();
+        entry->valid = true;
+    }
+}
+
+
+/* Invalidate registers affected by a write */
+void S8_cache::written(uint16_t reg, uint16_t value) {
+
+    if (reg == MODBUS_HR32) {
+        put(MODBUS_FUNC_READ_HOLDING_REGISTERS, MODBUS_HR32, (int16_t)value);     // Echo verified, value is known
+
+    } else if (reg == MODBUS_HR1) {
+        find(MODBUS_FUNC_READ_HOLDING_REGISTERS, MODBUS_HR1)->valid = false;
+
+    } else {
+        // Special command (calibration) changes acknowledgement flags and measures
+        for (uint8_t i = 0; i < S8_CACHE_ENTRIES; i++) {
+            if (entries[i].ttl_ms != S8_CACHE_TTL_FOREVER) {
+                entries[i].valid = false;
+            }
+        }
+    }
+}
+
+
+void S8_cache::clear() {
+    for (uint8_t i = 0; i < S8_CACHE_ENTRIES; i++) {
+        entries[i].valid = false;
+    }
+}
@@ -0,0 +1,78 @@
+/***************************************************************************************************************************
+
+	SenseAir S8 Register Cache
+
+	Copyright (c) 2021 Josep Comas
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+	SOFTWARE.
+
+***************************************************************************************************************************/
+
+
+#ifndef _S8_CACHE_H
+    #define _S8_CACHE_H
+
+    #include "s8_registers.h"
+
+
+    #define S8_CACHE_TTL_SHORT      1000ul          // Time to live of measures and flags (less than measurement period)
+    #define S8_CACHE_TTL_FOREVER    0xFFFFFFFFul    // Time to live of identity and configuration
+    #define S8_CACHE_ENTRIES        11
+
+
+    /*
+        Cache of registers read by the getters of S8_UART (opt-in with S8_UART::set_cache)
+
+        Measures and flags (IR1-IR4, IR22, HR1) have a short time to live, identity (IR26-IR31) and ABC period
+        (HR32) never expire. Writes of HR1, HR2 and HR32 invalidate the affected registers.
+    */
+    class S8_cache
+    {
+        public:
+            S8_cache();
+
+            void set_ttl(uint8_t func, uint16_t addr, uint32_t ttl_ms);            // Change time to live of a register
+
+            template <class REG>
+            void set_ttl(uint32_t ttl_ms) { set_ttl(REG::func, REG::addr, ttl_ms); }
+
+            bool get(uint8_t func, uint16_t addr, int32_t &value);                  // Valid value of a register (counts hit or miss)
+            void put(uint8_t func, uint16_t addr, int32_t value);                   // Save value read
+            void written(uint16_t reg, uint16_t value);                             // Holding register written
+            void clear();                                                           // Invalidate all registers
+
+            uint32_t hits;
+            uint32_t misses;
+
+        private:
+            struct Entry {
+                uint8_t func;
+                uint16_t addr;
+                bool valid;
+                uint32_t ttl_ms;
+                uint32_t time;
+                int32_t value;
+            };
+
+            Entry entries[S8_CACHE_ENTRIES];
+
+            Entry *find(uint8_t func, uint16_t addr);
+    };
+
+#endif
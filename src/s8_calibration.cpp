@@ -0,0 +1,219 @@
+/***************************************************************************************************************************
+
+	SenseAir S8 Non-blocking Calibration
+
+	Copyright (c) 2021 Josep Comas
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+	SOFTWARE.
+
+***************************************************************************************************************************/
+
+
+#include "s8_calibration.h"
+
+
+S8_calibration::S8_calibration(S8_UART &sensor) {
+    this->sensor = &sensor;
+    callback = NULL;
+    stable_readings = 0;
+    tolerance_ppm = 0;
+    stability_wait_ms = 0;
+    timeout_ms = S8_CALIBRATION_TIMEOUT;
+    cal_state = S8_CALIBRATION_IDLE;
+    cal_progress = 0;
+    pending = false;
+}
+
+
+void S8_calibration::set_stability(uint8_t readings, int16_t tolerance_ppm, uint32_t max_wait_ms) {
+    stable_readings = readings;
+    this->tolerance_ppm = tolerance_ppm;
+    stability_wait_ms = max_wait_ms;
+}
+
+
+bool S8_calibration::start(int16_t command) {
+
+    if (busy() || (command != S8_CO2_BACKGROUND_CALIBRATION && command != S8_CO2_ZERO_CALIBRATION)) {
+        return false;
+    }
+
+    this->command = command;
+    ack_mask = (command == S8_CO2_ZERO_CALIBRATION) ? S8_MASK_CO2_NITROGEN_CALIBRATION : S8_MASK_CO2_BACKGROUND_CALIBRATION;
+    pending = false;
+    stable = 0;
+    next_read = millis();
+
+    if (stable_readings > 0) {
+        set_state(S8_CALIBRATION_STABILITY, 0);
+    } else {
+        set_state(S8_CALIBRATION_CLEAR_ACK, 50);
+    }
+
+    return true;
+}
+
+
+void S8_calibration::set_state(uint8_t state, uint8_t progress) {
+    bool changed = (state != cal_state || progress != cal_progress);
+
+    if (state != cal_state) {
+        state_start = millis();
+    }
+
+    cal_state = state;
+    cal_progress = progress;
+
+    if (changed && callback != NULL) {
+        callback(cal_state, cal_progress);
+    }
+}
+
+
+uint8_t S8_calibration::tick() {
+    uint32_t now = millis();
+
+    if (!busy()) {
+        return cal_state;
+    }
+
+    if (pending) {
+        uint8_t status = sensor->poll_transaction();
+
+        if (status == S8_TRANSACTION_PENDING) {
+            return cal_state;
+        }
+
+        pending = false;
+        if (status == S8_TRANSACTION_DONE) {
+            process(now);
+
+        } else if (cal_state == S8_CALIBRATION_CLEAR_ACK || cal_state == S8_CALIBRATION_COMMAND) {
+            LOG_DEBUG_ERROR("Error starting manual calibration!");
+            set_state(S8_CALIBRATION_FAILED, cal_progress);
+            return cal_state;
+
+        } else {
+            next_read = now + S8_CALIBRATION_POLL_INTERVAL;     // Read again later
+        }
+    }
+
+    // Timeouts
+    if (cal_state == S8_CALIBRATION_STABILITY && (now - state_start) > stability_wait_ms) {
+        LOG_DEBUG_ERROR("CO2 value is not stable!");
+        set_state(S8_CALIBRATION_FAILED, cal_progress);
+        return cal_state;
+    }
+
+    if (cal_state == S8_CALIBRATION_WAIT_ACK && (now - state_start) > timeout_ms) {
+        LOG_DEBUG_ERROR("Timeout waiting manual calibration!");
+        set_state(S8_CALIBRATION_FAILED, cal_progress);
+        return cal_state;
+    }
+
+    if (pending || (int32_t)(now - next_read) < 0) {
+        return cal_state;
+    }
+
+    // Next transaction
+    switch (cal_state) {
+        case S8_CALIBRATION_STABILITY:
+            pending = sensor->request_read<S8_reg_co2>();
+            break;
+
+        case S8_CALIBRATION_CLEAR_ACK:
+            pending = sensor->request_write(MODBUS_HR1, 0x0000);
+            break;
+
+        case S8_CALIBRATION_COMMAND:
+            pending = sensor->request_write(MODBUS_HR2, command);
+            break;
+
+        case S8_CALIBRATION_WAIT_ACK:
+            pending = sensor->request_read<S8_reg_acknowledgement>();
+            break;
+    }
+
+    if (!pending) {
+        next_read = now + S8_CALIBRATION_POLL_INTERVAL;      // Sensor busy, try later
+    }
+
+    return cal_state;
+}
+
+
+/* Transaction finished */
+void S8_calibration::process(uint32_t now) {
+
+    switch (cal_state) {
+        case S8_CALIBRATION_STABILITY: {
+            int16_t co2 = sensor->response_value<S8_reg_co2>();
+
+            int16_t new_min = (stable == 0 || co2 < co2_min) ? co2 : co2_min;
+            int16_t new_max = (stable == 0 || co2 > co2_max) ? co2 : co2_max;
+
+            if (stable > 0 && new_max - new_min <= tolerance_ppm) {
+                co2_min = new_min;
+                co2_max = new_max;
+                stable++;
+            } else {
+                co2_min = co2;          // Start again
+                co2_max = co2;
+                stable = 1;
+            }
+
+            if (stable >= stable_readings) {
+                set_state(S8_CALIBRATION_CLEAR_ACK, 50);
+                next_read = now;
+            } else {
+                set_state(S8_CALIBRATION_STABILITY, (uint16_t)stable * 50 / stable_readings);
+                next_read = now + S8_CALIBRATION_POLL_INTERVAL;
+            }
+            break;
+        }
+
+        case S8_CALIBRATION_CLEAR_ACK:
+            set_state(S8_CALIBRATION_COMMAND, 60);
+            next_read = now;
+            break;
+
+        case S8_CALIBRATION_COMMAND:
+            if (command == S8_CO2_ZERO_CALIBRATION) {
+                LOG_DEBUG_INFO("Manual calibration with zero (nitrogen) has started");
+            } else {
+                LOG_DEBUG_INFO("Manual calibration in background has started");
+            }
+            set_state(S8_CALIBRATION_WAIT_ACK, 70);
+            next_read = now + S8_CALIBRATION_POLL_INTERVAL;
+            break;
+
+        case S8_CALIBRATION_WAIT_ACK:
+            if (sensor->response_value<S8_reg_acknowledgement>() & ack_mask) {
+                LOG_DEBUG_INFO("Manual calibration is finished");
+                set_state(S8_CALIBRATION_DONE, 100);
+            } else {
+                // Progress is the time waited of the timeout, the sensor does not tell it
+                uint32_t elapsed = now - state_start;
+                uint32_t waited = (timeout_ms > 0 && elapsed < timeout_ms) ? (uint64_t)elapsed * 29 / timeout_ms : 29;
+                set_state(S8_CALIBRATION_WAIT_ACK, 70 + waited);
+                next_read = now + S8_CALIBRATION_POLL_INTERVAL;
+            }
+            break;
+    }
+}
@@ -0,0 +1,97 @@
+/***************************************************************************************************************************
+
+	SenseAir S8 Non-blocking Calibration
+
+	Copyright (c) 2021 Josep Comas
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+	SOFTWARE.
+
+***************************************************************************************************************************/
+
+
+#ifndef _S8_CALIBRATION_H
+    #define _S8_CALIBRATION_H
+
+    #include "s8_uart.h"
+
+
+    #define S8_CALIBRATION_POLL_INTERVAL   2000ul      // Interval of reads (CO2 stability and acknowledgement), one lamp cycle
+    #define S8_CALIBRATION_TIMEOUT        60000ul      // Max time waiting the acknowledgement of calibration
+
+    // States of calibration
+    #define S8_CALIBRATION_IDLE            0
+    #define S8_CALIBRATION_STABILITY       1           // Waiting stable CO2 value
+    #define S8_CALIBRATION_CLEAR_ACK       2           // Clearing acknowledgement flags
+    #define S8_CALIBRATION_COMMAND         3           // Sending calibration command
+    #define S8_CALIBRATION_WAIT_ACK        4           // Polling acknowledgement flags
+    #define S8_CALIBRATION_DONE            5           // Calibration finished
+    #define S8_CALIBRATION_FAILED          6           // Error or timeout
+
+
+    typedef void (*S8_calibration_callback)(uint8_t state, uint8_t progress);       // State or progress (%) changed
+
+
+    /*
+        Manual calibration as a state machine called from loop() with tick(), it never blocks
+
+        Optionally it waits until CO2 is stable (readings within a tolerance), then it clears acknowledgement
+        flags, sends the calibration command and polls HR1 every lamp cycle until the flag of the calibration
+        is set or timeout.
+    */
+    class S8_calibration
+    {
+        public:
+            S8_calibration(S8_UART &sensor);
+
+            void set_stability(uint8_t readings, int16_t tolerance_ppm, uint32_t max_wait_ms);  // Stable readings needed (0 = don't wait)
+            void set_timeout(uint32_t timeout_ms) { this->timeout_ms = timeout_ms; }            // Timeout waiting acknowledgement
+            void on_progress(S8_calibration_callback callback) { this->callback = callback; }
+
+            bool start(int16_t command = S8_CO2_BACKGROUND_CALIBRATION);           // Start calibration (background or zero)
+            uint8_t tick();                                                         // Call it from loop(), returns state
+
+            uint8_t state() { return cal_state; }
+            uint8_t progress() { return cal_progress; }                             // Progress (%), 70-99 % is the time waited of the timeout
+            bool busy() { return cal_state != S8_CALIBRATION_IDLE && cal_state != S8_CALIBRATION_DONE && cal_state != S8_CALIBRATION_FAILED; }
+
+        private:
+            S8_UART *sensor;
+            S8_calibration_callback callback;
+
+            uint8_t stable_readings;
+            int16_t tolerance_ppm;
+            uint32_t stability_wait_ms;
+            uint32_t timeout_ms;
+
+            int16_t command;
+            uint16_t ack_mask;
+            uint8_t cal_state;
+            uint8_t cal_progress;
+            bool pending;
+            uint8_t stable;
+            int16_t co2_min;
+            int16_t co2_max;
+            uint32_t state_start;
+            uint32_t next_read;
+
+            void set_state(uint8_t state, uint8_t progress);
+            void process(uint32_t now);
+    };
+
+#endif
@@ -0,0 +1,241 @@
+/***************************************************************************************************************************
+
+	C++20 Coroutines for S8 transactions
+
+	Copyright (c) 2021 Josep Comas
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+	SOFTWARE.
+
+***************************************************************************************************************************/
+
+
+#ifndef _S8_CORO_H
+    #define _S8_CORO_H
+
+    #include "s8_uart.h"
+
+    #if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+
+    #include <coroutine>
+
+    #define S8_HAS_COROUTINES
+
+
+    /*
+        Coroutines on top of the non-blocking transactions of S8_UART
+
+        A coroutine (returning S8_co_task) awaits transactions of a sensor (co_await sensor.read_co2()) or a delay
+        (co_await scheduler.sleep(2000)). One S8_co_scheduler, called from loop() or a single thread, polls all
+        transactions in flight and resumes the coroutines when they finish. It never blocks.
+
+            S8_co_task poll_sensor(S8_co_sensor &sensor) {
+                while (true) {
+                    auto co2 = co_await sensor.read_co2();
+                    if (co2) printf("CO2 = %d ppm\n", co2.value);
+                    co_await sensor.scheduler().sleep(2000);
+                }
+            }
+    */
+
+
+    /* Result of a transaction awaited by a coroutine */
+    template <class T>
+    struct S8_co_result {
+        uint8_t status;                                                             // S8_TRANSACTION_DONE, _ERROR or _TIMEOUT
+        T value;                                                                    // Value read (0 if not done)
+
+        explicit operator bool() const { return status == S8_TRANSACTION_DONE; }
+    };
+
+
+    /* Operation in flight (transaction of a sensor or delay) */
+    struct S8_co_pending {
+        S8_UART *sensor;                                                            // NULL for a delay
+        uint32_t start_ms;
+        uint32_t delay_ms;
+        uint8_t status;
+        std::coroutine_handle<> handle;
+        S8_co_pending *next;
+    };
+
+
+    class S8_co_scheduler
+    {
+        public:
+            /* Awaitable delay */
+            struct sleep_awaiter : S8_co_pending {
+                S8_co_scheduler *scheduler;
+
+                bool await_ready() { return delay_ms == 0; }
+                void await_suspend(std::coroutine_handle<> h) { handle = h; scheduler->add(this); }
+                void await_resume() {}
+            };
+
+            sleep_awaiter sleep(uint32_t ms) {
+                sleep_awaiter awaiter;
+                awaiter.sensor = NULL;
+                awaiter.start_ms = millis();
+                awaiter.delay_ms = ms;
+                awaiter.scheduler = this;
+                return awaiter;
+            }
+
+            void add(S8_co_pending *pending) {
+                pending->next = head;
+                head = pending;
+            }
+
+            /* Poll operations in flight and resume finished ones (returns operations still in flight) */
+            int run_once() {
+                S8_co_pending **link = &head;
+                int in_flight = 0;
+
+                while (*link != NULL) {
+                    S8_co_pending *pending = *link;
+                    bool finished;
+
+                    if (pending->sensor != NULL) {
+                        pending->status = pending->sensor->poll_transaction();
+                        finished = (pending->status != S8_TRANSACTION_PENDING);
+                    } else {
+                        finished = (millis() - pending->start_ms) >= pending->delay_ms;
+                    }
+
+                    if (finished) {
+                        *link = pending->next;
+                        pending->handle.resume();       // It can add new operations at head
+                    } else {
+                        link = &pending->next;
+                        in_flight++;
+                    }
+                }
+
+                return in_flight;
+            }
+
+            bool idle() const { return head == NULL; }
+
+        private:
+            S8_co_pending *head = NULL;
+    };
+
+
+    /* Awaitable read of a register (or block) described in s8_registers.h */
+    template <class REG>
+    struct S8_co_read_awaiter : S8_co_pending {
+        S8_co_scheduler *scheduler;
+
+        bool await_ready() { return false; }
+
+        bool await_suspend(std::coroutine_handle<> h) {
+            if (!sensor->request_read<REG>()) {
+                status = S8_TRANSACTION_ERROR;
+                return false;                                                       // Resume now
+            }
+            handle = h;
+            scheduler->add(this);
+            return true;
+        }
+
+        S8_co_result<typename REG::value_type> await_resume() {
+            S8_co_result<typename REG::value_type> result;
+            result.status = status;
+            result.value = (status == S8_TRANSACTION_DONE) ? sensor->response_value<REG>() : 0;
+            return result;
+        }
+    };
+
+
+    /* Awaitable write of a holding register (result value is the value written) */
+    struct S8_co_write_awaiter : S8_co_pending {
+        S8_co_scheduler *scheduler;
+        uint16_t reg;
+        uint16_t value;
+
+        bool await_ready() { return false; }
+
+        bool await_suspend(std::coroutine_handle<> h) {
+            if (!sensor->request_write(reg, value)) {
+                status = S8_TRANSACTION_ERROR;
+                return false;
+            }
+            handle = h;
+            scheduler->add(this);
+            return true;
+        }
+
+        S8_co_result<int16_t> await_resume() {
+            S8_co_result<int16_t> result;
+            result.status = status;
+            result.value = (status == S8_TRANSACTION_DONE) ? value : 0;
+            return result;
+        }
+    };
+
+
+    /* Sensor with awaitable transactions (one transaction in flight per sensor) */
+    class S8_co_sensor
+    {
+        public:
+            S8_co_sensor(S8_UART &sensor, S8_co_scheduler &scheduler) : sensor(&sensor), sched(&scheduler) {}
+
+            S8_co_scheduler &scheduler() { return *sched; }
+
+            template <class REG>
+            S8_co_read_awaiter<REG> read() {
+                S8_co_read_awaiter<REG> awaiter;
+                awaiter.sensor = sensor;
+                awaiter.scheduler = sched;
+                return awaiter;
+            }
+
+            S8_co_write_awaiter write(uint16_t reg, uint16_t value) {
+                S8_co_write_awaiter awaiter;
+                awaiter.sensor = sensor;
+                awaiter.scheduler = sched;
+                awaiter.reg = reg;
+                awaiter.value = value;
+                return awaiter;
+            }
+
+            S8_co_read_awaiter<S8_reg_co2> read_co2() { return read<S8_reg_co2>(); }
+            S8_co_read_awaiter<S8_reg_meter_status> read_meter_status() { return read<S8_reg_meter_status>(); }
+            S8_co_read_awaiter<S8_reg_abc_period> read_ABC_period() { return read<S8_reg_abc_period>(); }
+            S8_co_read_awaiter<S8_reg_sensor_id> read_sensor_ID() { return read<S8_reg_sensor_id>(); }
+
+        private:
+            S8_UART *sensor;
+            S8_co_scheduler *sched;
+    };
+
+
+    /* Return type of a coroutine started immediately and destroyed when it ends */
+    struct S8_co_task {
+        struct promise_type {
+            S8_co_task get_return_object() { return S8_co_task(); }
+            std::suspend_never initial_suspend() noexcept { return {}; }
+            std::suspend_never final_suspend() noexcept { return {}; }
+            void return_void() {}
+            void unhandled_exception() {}
+        };
+    };
+
+    #endif
+
+#endif
@@ -0,0 +1,289 @@
+/***************************************************************************************************************************
+
+	Linux epoll Engine for many S8 sensors
+
+	Copyright (c) 2021 Josep Comas
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+	SOFTWARE.
+
+***************************************************************************************************************************/
+
+
+#include "s8_epoll.h"
+
+#ifdef S8_HAS_EPOLL
+
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+#include <errno.h>
+
+#define S8_EPOLL_EVENTS   64        // Events processed by epoll_wait call
+
+
+// Data of an epoll event: index of sensor and type of descriptor
+#define EPOLL_DATA(index, timer)    (((uint64_t)(index) << 1) | ((timer) ? 1 : 0))
+
+
+S8_epoll_engine::S8_epoll_engine() {
+    slots = NULL;
+    max_slots = 0;
+    n_slots = 0;
+    epoll_fd = -1;
+    timeout_ms = 1000;
+    running = false;
+    callback = NULL;
+    context = NULL;
+    transactions = 0;
+    errors = 0;
+    timeouts = 0;
+}
+
+
+S8_epoll_engine::~S8_epoll_engine() {
+    end();
+}
+
+
+bool S8_epoll_engine::begin(int max_sensors, uint32_t timeout_ms) {
+    end();
+
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd < 0) {
+        LOG_DEBUG_ERROR("Error creating epoll!");
+        return false;
+    }
+
+    slots = new Slot[max_sensors];
+    max_slots = max_sensors;
+    this->timeout_ms = timeout_ms;
+
+    return true;
+}
+
+
+void S8_epoll_engine::end() {
+    for (int i = 0; i < n_slots; i++) {
+        close(slots[i].timer_fd);
+    }
+
+    if (epoll_fd >= 0) {
+        close(epoll_fd);
+        epoll_fd = -1;
+    }
+
+    delete[] slots;
+    slots = NULL;
+    max_slots = 0;
+    n_slots = 0;
+}
+
+
+/* Add a sensor, the first transaction starts at next run */
+int S8_epoll_engine::add(S8_UART &sensor, int fd, uint8_t func, uint16_t reg, uint8_t words, uint32_t period_ms) {
+    struct epoll_event ev;
+
+    if (n_slots >= max_slots) {
+        LOG_DEBUG_ERROR("Too many sensors!");
+        return -1;
+    }
+
+    int index = n_slots;
+    Slot &slot = slots[index];
+
+    slot.timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (slot.timer_fd < 0) {
+        LOG_DEBUG_ERROR("Error creating timer!");
+        return -1;
+    }
+
+    slot.sensor = &sensor;
+    slot.fd = fd;
+    slot.func = func;
+    slot.reg = reg;
+    slot.words = words;
+    slot.period_ms = period_ms;
+    slot.start_ms = 0;
+
+    ev.events = EPOLLIN;
+    ev.data.u64 = EPOLL_DATA(index, false);
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev) != 0) {
+        close(slot.timer_fd);
+        LOG_DEBUG_ERROR("Error adding descriptor to epoll!");
+        return -1;
+    }
+
+    ev.data.u64 = EPOLL_DATA(index, true);
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, slot.timer_fd, &ev);
+
+    n_slots++;
+    arm(slot, 0);
+
+    return index;
+}
+
+
+void S8_epoll_engine::set_callback(S8_epoll_callback callback, void *context) {
+    this->callback = callback;
+    this->context = context;
+}
+
+
+/* Wait events and dispatch them */
+int S8_epoll_engine::run_once(int timeout_ms) {
+    struct epoll_event events[S8_EPOLL_EVENTS];
+
+    int n = epoll_wait(epoll_fd, events, S8_EPOLL_EVENTS, timeout_ms);
+    if (n < 0) {
+        return (errno == EINTR) ? 0 : -1;
+    }
+
+    for (int i = 0; i < n; i++) {
+        int index = events[i].data.u64 >> 1;
+
+        if (events[i].data.u64 & 1) {
+            on_timer(index);
+        } else {
+            on_input(index, events[i].events);
+        }
+    }
+
+    return n;
+}
+
+
+void S8_epoll_engine::run() {
+    running = true;
+
+    while (running && run_once(100) >= 0) {
+    }
+}
+
+
+/* Arm timer of a sensor (0 = as soon as possible) */
+void S8_epoll_engine::arm(Slot &slot, uint32_t ms) {
+    struct itimerspec its = {};
+
+    its.it_value.tv_sec = ms / 1000;
+    its.it_value.tv_nsec = (ms % 1000) * 1000000l;
+    if (ms == 0) {
+        its.it_value.tv_nsec = 1;       // Zero would disarm the timer
+    }
+
+    timerfd_settime(slot.timer_fd, 0, &its, NULL);
+}
+
+
+/* Stop timer of a sensor */
+void S8_epoll_engine::disarm(Slot &slot) {
+    struct itimerspec its = {};
+
+    timerfd_settime(slot.timer_fd, 0, &its, NULL);
+}
+
+
+/* Send request and arm the response deadline */
+void S8_epoll_engine::start(Slot &slot) {
+    slot.start_ms = millis();
+
+    if (slot.sensor->request_read(slot.func, slot.reg, slot.words)) {
+        arm(slot, timeout_ms);
+    } else {
+        arm(slot, slot.period_ms);
+    }
+}
+
+
+/* Report transaction and schedule next one */
+void S8_epoll_engine::finish(int index, uint8_t status) {
+    Slot &slot = slots[index];
+
+    transactions++;
+    if (status == S8_TRANSACTION_ERROR) {
+        errors++;
+    } else if (status == S8_TRANSACTION_TIMEOUT) {
+        timeouts++;
+    }
+
+    if (callback != NULL) {
+        callback(context, index, *slot.sensor, status);
+    }
+
+    if (slot.fd < 0) {
+        disarm(slot);
+        return;
+    }
+
+    uint32_t elapsed = millis() - slot.start_ms;
+    if (slot.period_ms == 0) {
+        start(slot);
+    } else {
+        arm(slot, (elapsed < slot.period_ms) ? slot.period_ms - elapsed : 0);
+    }
+}
+
+
+/* Period elapsed (start transaction) or deadline reached (cancel it) */
+void S8_epoll_engine::on_timer(int index) {
+    Slot &slot = slots[index];
+    uint64_t expirations;
+
+    if (read(slot.timer_fd, &expirations, sizeof(expirations)) != sizeof(expirations) || slot.fd < 0) {
+        return;
+    }
+
+    if (slot.sensor->transaction_status() == S8_TRANSACTION_PENDING) {
+        slot.sensor->cancel_transaction();
+        finish(index, S8_TRANSACTION_TIMEOUT);
+    } else {
+        start(slot);
+    }
+}
+
+
+/* Bytes received from a sensor, or hang-up / error of its port */
+void S8_epoll_engine::on_input(int index, uint32_t events) {
+    Slot &slot = slots[index];
+
+    // Level triggered, a closed port would wake epoll_wait until it is removed
+    if (events & (EPOLLHUP | EPOLLERR)) {
+        LOG_DEBUG_ERROR("Port closed or failed, sensor removed: ", index);
+        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, slot.fd, NULL);
+        slot.fd = -1;
+
+        if (slot.sensor->transaction_status() == S8_TRANSACTION_PENDING) {
+            slot.sensor->cancel_transaction(S8_TRANSACTION_ERROR);
+            finish(index, S8_TRANSACTION_ERROR);
+        } else {
+            disarm(slot);
+        }
+
+    } else if (slot.sensor->transaction_status() == S8_TRANSACTION_PENDING) {
+        uint8_t status = slot.sensor->poll_transaction();
+
+        if (status != S8_TRANSACTION_PENDING) {
+            finish(index, status);
+        }
+
+    } else {
+        slot.sensor->discard_input();   // Unexpected bytes, through the transport (capture sees them)
+    }
+}
+
+#endif
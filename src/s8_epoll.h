@@ -0,0 +1,108 @@
+/***************************************************************************************************************************
+
+	Linux epoll Engine for many S8 sensors
+
+	Copyright (c) 2021 Josep Comas
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+	SOFTWARE.
+
+***************************************************************************************************************************/
+
+
+#ifndef _S8_EPOLL_H
+    #define _S8_EPOLL_H
+
+    #include "s8_uart.h"
+
+    #if defined(S8_HOST) && defined(__linux__)
+
+    #define S8_HAS_EPOLL
+
+
+    class S8_epoll_engine;
+
+    /* Called when a transaction of a sensor finishes (status = S8_TRANSACTION_DONE, _ERROR or _TIMEOUT) */
+    typedef void (*S8_epoll_callback)(void *context, int index, S8_UART &sensor, uint8_t status);
+
+
+    /*
+        Event loop polling many sensors from one thread
+
+        Every sensor reads periodically a block of registers as a non-blocking transaction. The file descriptors
+        of the ports and one timerfd per sensor (period and response deadline) are multiplexed in one epoll.
+        A port that hangs up or fails (EPOLLHUP, EPOLLERR) is removed, its pending transaction ends with
+        S8_TRANSACTION_ERROR and the sensor is not polled anymore.
+    */
+    class S8_epoll_engine
+    {
+        public:
+            S8_epoll_engine();
+            ~S8_epoll_engine();
+
+            bool begin(int max_sensors, uint32_t timeout_ms = 1000);               // Create epoll (timeout of every transaction)
+            void end();
+
+            int add(S8_UART &sensor, int fd, uint8_t func, uint16_t reg, uint8_t words, uint32_t period_ms);   // Add sensor (returns index or -1)
+            void set_callback(S8_epoll_callback callback, void *context);
+
+            template <class REG>
+            int add(S8_UART &sensor, int fd, uint32_t period_ms) {
+                return add(sensor, fd, REG::func, REG::addr, REG::words, period_ms);
+            }
+
+            int run_once(int timeout_ms);                                           // Wait and process events (returns events processed, -1 on error)
+            void run();                                                             // Process events until stop()
+            void stop() { running = false; }
+
+            uint32_t transactions;                                                  // Transactions finished
+            uint32_t errors;                                                        // Invalid responses
+            uint32_t timeouts;                                                      // Responses not received before deadline
+
+        private:
+            struct Slot {
+                S8_UART *sensor;
+                int fd;                                                             // -1 after a hang-up of the port
+                int timer_fd;
+                uint8_t func;
+                uint16_t reg;
+                uint8_t words;
+                uint32_t period_ms;
+                uint32_t start_ms;
+            };
+
+            Slot *slots;
+            int max_slots;
+            int n_slots;
+            int epoll_fd;
+            uint32_t timeout_ms;
+            volatile bool running;
+            S8_epoll_callback callback;
+            void *context;
+
+            void arm(Slot &slot, uint32_t ms);
+            void start(Slot &slot);
+            void disarm(Slot &slot);
+            void finish(int index, uint8_t status);
+            void on_timer(int index);
+            void on_input(int index, uint32_t events);
+    };
+
+    #endif
+
+#endif
@@ -0,0 +1,137 @@
+/***************************************************************************************************************************
+
+	SenseAir S8 Fixed-Point Filter
+
+	Copyright (c) 2021 Josep Comas
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+	SOFTWARE.
+
+***************************************************************************************************************************/
+
+
+
+#include "s8_filter.h"
+
+
+S8_filter::S8_filter() {
+    median_size = 3;
+    set_ema(64);
+    q = 1 << 8;
+    r = 16 << 8;
+    reset();
+}
+
+
+void S8_filter::set_median(uint8_t size) {
+    median_size = (size < 1) ? 1 : (size > S8_FILTER_MEDIAN_MAX ? S8_FILTER_MEDIAN_MAX : size);
+    reset();
+}
+
+
+void S8_filter::set_ema(uint16_t alpha) {
+    this->alpha = (alpha < 1) ? 1 : (alpha > 256 ? 256 : alpha);
+    mode = FILTER_EMA;
+}
+
+
+void S8_filter::set_kalman(uint16_t q, uint16_t r) {
+    this->q = (uint32_t)q << 8;
+    this->r = ((uint32_t)(r < 1 ? 1 : r)) << 8;
+    mode = FILTER_KALMAN;
+    variance = this->r;
+}
+
+
+void S8_filter::reset() {
+    samples = 0;
+    oldest = 0;
+    state = 0;
+    variance = r;
+}
+
+
+/* Median of the last samples, the sorted copy is updated removing the oldest sample and inserting the new one */
+int16_t S8_filter::median(int16_t co2) {
+
+    uint8_t i;
+
+    if (median_size <= 1) {
+        return co2;
+    }
+
+    if (samples == median_size) {
+        int16_t old = window[oldest];
+        for (i = 0; sorted[i] != old; i++) {
+        }
+        for (; i + 1 < samples; i++) {
+            sorted[i] = sorted[i + 1];
+        }
+        samples--;
+    }
+
+    window[oldest] = co2;
+    oldest = (oldest + 1 < median_size) ? oldest + 1 : 0;
+
+    for (i = samples; i > 0 && sorted[i - 1] > co2; i--) {
+        sorted[i] = sorted[i - 1];
+    }
+    sorted[i] = co2;
+    samples++;
+
+    return sorted[samples / 2];
+}
+
+
+/* Same rounding for negative values (a right shift of a negative state rounds toward -infinity) */
+int16_t S8_filter::value() {
+    return (state >= 0) ? (state + 128) >> 8 : -((-state + 128) >> 8);
+}
+
+
+int16_t S8_filter::add(int16_t co2) {
+
+    bool first = (samples == 0);
+    int32_t z = (int32_t)median(co2) * 256;                                 // Not << 8, undefined for negative samples
+
+    if (median_size <= 1) {
+        samples = 1;
+    }
+
+    if (first) {
+        state = z;
+        variance = r;
+        return value();
+    }
+
+    if (mode == FILTER_KALMAN) {
+        // Predict (CO2 can change between samples) and correct with gain = variance / (variance + r)
+        variance += q;
+        if (variance > S8_FILTER_MAX_VARIANCE) {
+            variance = S8_FILTER_MAX_VARIANCE;
+        }
+        uint32_t gain = (variance << 8) / (variance + r);                      // 0 - 256
+        state += (int32_t)(((int64_t)(z - state) * gain) >> 8);
+        variance = (variance * (256 - gain)) >> 8;
+
+    } else {
+        state += (int32_t)(((int64_t)(z - state) * alpha) >> 8);
+    }
+
+    return value();
+}
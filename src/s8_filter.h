@@ -0,0 +1,79 @@
+/***************************************************************************************************************************
+
+	SenseAir S8 Fixed-Point Filter
+
+	Copyright (c) 2021 Josep Comas
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+	SOFTWARE.
+
+***************************************************************************************************************************/
+
+
+
+#ifndef _S8_FILTER_H
+    #define _S8_FILTER_H
+
+    #include <stdint.h>
+
+
+    #define S8_FILTER_MEDIAN_MAX     7       // Max samples of the median window
+    #define S8_FILTER_MAX_VARIANCE   0x3FFFFFul  // Limit of the variance of the Kalman filter (ppm² * 256)
+
+
+    /*
+        Noise filter of CO2 readings in integer arithmetic (firmware and host)
+
+        A median of the last N samples rejects spikes (ex: a glitchy frame), then the value is smoothed with an
+        exponential moving average or a 1-D Kalman filter. The state is kept in fixed point (1/256 ppm), the cost
+        per sample is constant and there is no floating point or dynamic memory.
+    */
+    class S8_filter
+    {
+        public:
+            S8_filter();
+
+            void set_median(uint8_t size);                                          // Samples of the median (1 = disabled, default 3, max S8_FILTER_MEDIAN_MAX)
+            void set_ema(uint16_t alpha);                                           // Moving average, weight of new sample alpha/256 (1-256, 256 = no smoothing)
+            void set_kalman(uint16_t q, uint16_t r);                                // Kalman filter, variance of CO2 change per sample and of measurement noise (ppm²)
+            void reset();                                                           // Forget samples
+
+            int16_t add(int16_t co2);                                               // New sample, returns filtered value
+            int16_t value();                                                        // Last filtered value (rounded half away from zero)
+            bool primed() { return samples > 0; }                                   // At least one sample
+
+        private:
+            enum { FILTER_EMA, FILTER_KALMAN };
+
+            uint8_t mode;
+            uint8_t median_size;
+            uint16_t alpha;
+            uint32_t q;                                                             // Process noise (ppm² * 256)
+            uint32_t r;                                                             // Measurement noise (ppm² * 256)
+
+            uint8_t samples;                                                        // Samples in the median window
+            uint8_t oldest;                                                         // Position of the oldest sample in window
+            int16_t window[S8_FILTER_MEDIAN_MAX];                                   // Samples in arrival order
+            int16_t sorted[S8_FILTER_MEDIAN_MAX];                                   // Same samples sorted
+            int32_t state;                                                          // Filtered value (ppm * 256)
+            uint32_t variance;                                                      // Variance of the Kalman estimate (ppm² * 256)
+
+            int16_t median(int16_t co2);
+    };
+
+#endif
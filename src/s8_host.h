@@ -0,0 +1,68 @@
+/***************************************************************************************************************************
+
+	Host Support (build without Arduino framework)
+
+	Copyright (c) 2021 Josep Comas
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+	SOFTWARE.
+
+***************************************************************************************************************************/
+
+
+#ifndef _S8_HOST_H
+    #define _S8_HOST_H
+
+    /*
+        Minimal replacement of the Arduino functions used by the library when it is built for a host
+        (Linux, ...). Debug messages and print utilities go to the standard output.
+    */
+
+    #include <stdint.h>
+    #include <stddef.h>
+    #include <stdio.h>
+    #include <string.h>
+
+    uint32_t millis();                                                              // Milliseconds since start (monotonic)
+    uint32_t micros();                                                              // Microseconds since start (monotonic)
+    void delay(uint32_t ms);                                                        // Sleep milliseconds
+    inline void yield() {}
+
+
+    /* Standard output with the print functions used by debug macros */
+    class S8_host_print
+    {
+        public:
+            size_t print(const char *str)      { return printf("%s", str); }
+            size_t print(char c)               { return printf("%c", c); }
+            size_t print(int value)            { return printf("%d", value); }
+            size_t print(unsigned int value)   { return printf("%u", value); }
+            size_t print(long value)           { return printf("%ld", value); }
+            size_t print(unsigned long value)  { return printf("%lu", value); }
+            size_t print(double value)         { return printf("%.2f", value); }
+
+            template <class T>
+            size_t println(T value)            { size_t n = print(value); return n + printf("\n"); }
+            size_t println()                   { return printf("\n"); }
+
+            void flush()                       { fflush(stdout); }
+    };
+
+    extern S8_host_print Serial;
+
+#endif
@@ -0,0 +1,211 @@
+/***************************************************************************************************************************
+
+	SenseAir S8 Identity Persistence
+
+	Copyright (c) 2021 Josep Comas
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+	SOFTWARE.
+
+***************************************************************************************************************************/
+
+
+
+#include <stddef.h>
+#include "s8_identity.h"
+#include "modbus_crc.h"
+#include "utils.h"
+
+#ifdef S8_HAS_EEPROM_STORAGE
+#include <EEPROM.h>
+#endif
+
+
+/* Check version and CRC of saved identity */
+bool S8_identity_valid(const S8_identity &identity) {
+    return identity.version == S8_IDENTITY_VERSION &&
+           identity.crc == modbus_CRC16((uint8_t *)&identity, offsetof(S8_identity, crc));
+}
+
+
+/* Set version and CRC before saving */
+void S8_identity_seal(S8_identity &identity) {
+    identity.version = S8_IDENTITY_VERSION;
+    identity.crc = modbus_CRC16((uint8_t *)&identity, offsetof(S8_identity, crc));
+}
+
+
+S8_identity_store::S8_identity_store(S8_UART &sensor, S8_storage &storage) {
+    this->sensor = &sensor;
+    this->storage = &storage;
+    transactions = 0;
+    loaded = false;
+}
+
+
+/* Fill identity of info, from storage if the sensor is the same */
+bool S8_identity_store::begin(S8_sensor &info) {
+
+    S8_identity identity;
+
+    loaded = false;
+
+    // Sensor ID identifies the saved data
+    info.sensor_id = sensor->get_sensor_ID();
+    transactions = 1;
+    if (info.sensor_id == 0) {
+        LOG_DEBUG_ERROR("Sensor ID not available!");
+        return false;
+    }
+
+    if (storage->load(info.sensor_id, identity) && S8_identity_valid(identity) && identity.sensor_id == info.sensor_id) {
+        LOG_DEBUG_INFO("Identity loaded from storage");
+        strcpy(info.firm_version, identity.firm_version);
+        info.sensor_type_id = identity.sensor_type_id;
+        info.map_version = identity.map_version;
+        info.abc_period = identity.abc_period;
+        loaded = true;
+        return true;
+    }
+
+    // Read identity and save it
+    sensor->get_firmware_version(info.firm_version);
+    info.sensor_type_id = sensor->get_sensor_type_ID();
+    info.map_version = sensor->get_memory_map_version();
+    info.abc_period = sensor->get_ABC_period();
+    transactions += 4;
+
+    if (strlen(info.firm_version) == 0 || info.sensor_type_id == 0 || info.map_version == 0) {
+        LOG_DEBUG_ERROR("Identity not available!");
+        return false;
+    }
+
+    save(info);
+    return true;
+}
+
+
+/* Save identity of info */
+bool S8_identity_store::save(const S8_sensor &info) {
+
+    S8_identity identity;
+
+    memset(&identity, 0, sizeof(identity));     // Padding is included in the CRC
+    snprintf(identity.firm_version, sizeof(identity.firm_version), "%s", info.firm_version);
+    identity.sensor_id = info.sensor_id;
+    identity.sensor_type_id = info.sensor_type_id;
+    identity.map_version = info.map_version;
+    identity.abc_period = info.abc_period;
+    S8_identity_seal(identity);
+
+    bool result = storage->save(identity);
+    if (!result) {
+        LOG_DEBUG_ERROR("Error saving identity!");
+    }
+
+    return result;
+}
+
+
+#ifdef ARDUINO_ARCH_ESP32
+
+/* Load identity of a sensor from NVS */
+bool S8_nvs_storage::load(int32_t sensor_id, S8_identity &identity) {
+
+    char key[9];
+    bool result = false;
+
+    snprintf(key, sizeof(key), "%08lX", (unsigned long)sensor_id);
+
+    if (prefs.begin(name_space, true)) {
+        result = (prefs.getBytes(key, &identity, sizeof(identity)) == sizeof(identity));
+        prefs.end();
+    }
+
+    return result;
+}
+
+
+/* Save identity of a sensor in NVS (only if it is different, to avoid flash writes) */
+bool S8_nvs_storage::save(const S8_identity &identity) {
+
+    char key[9];
+    S8_identity saved;
+    bool result = false;
+
+    snprintf(key, sizeof(key), "%08lX", (unsigned long)identity.sensor_id);
+
+    if (prefs.begin(name_space, false)) {
+        if (prefs.getBytes(key, &saved, sizeof(saved)) == sizeof(saved) && memcmp(&saved, &identity, sizeof(saved)) == 0) {
+            result = true;
+        } else {
+            result = (prefs.putBytes(key, &identity, sizeof(identity)) == sizeof(identity));
+        }
+        prefs.end();
+    }
+
+    return result;
+}
+
+#endif
+
+
+#ifdef S8_HAS_EEPROM_STORAGE
+
+// Cores with EEPROM emulated in flash need begin(size) and commit()
+#if defined(ARDUINO_ARCH_ESP32) || defined(ARDUINO_ARCH_ESP8266) || defined(ARDUINO_ARCH_RP2040)
+    #define S8_EEPROM_EMULATED
+#endif
+
+
+/* Copy of the flash sector in RAM, only once (every call would allocate and read it again) */
+void S8_eeprom_storage::begin() {
+
+#ifdef S8_EEPROM_EMULATED
+    if (!started) {
+        EEPROM.begin(address + sizeof(S8_identity));
+        started = true;
+    }
+#endif
+}
+
+
+/* Load identity of a sensor from EEPROM */
+bool S8_eeprom_storage::load(int32_t sensor_id, S8_identity &identity) {
+
+    begin();
+    EEPROM.get(address, identity);
+    return identity.sensor_id == sensor_id;
+}
+
+
+/* Save identity of a sensor in EEPROM (EEPROM.put only writes the bytes that change) */
+bool S8_eeprom_storage::save(const S8_identity &identity) {
+
+    begin();
+
+#ifdef S8_EEPROM_EMULATED
+    EEPROM.put(address, identity);
+    return EEPROM.commit();
+#else
+    EEPROM.put(address, identity);
+    return true;
+#endif
+}
+
+#endif
@@ -0,0 +1,158 @@
+/***************************************************************************************************************************
+
+	SenseAir S8 Identity Persistence
+
+	Copyright (c) 2021 Josep Comas
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+	SOFTWARE.
+
+***************************************************************************************************************************/
+
+
+
+#ifndef _S8_IDENTITY_H
+    #define _S8_IDENTITY_H
+
+    #include "s8_uart.h"
+
+
+    #define S8_IDENTITY_VERSION     1       // Change it if S8_identity changes (old saved data is ignored)
+
+
+    /* Identity and configuration of a sensor saved between boots */
+    struct S8_identity {
+        uint8_t version;
+        char firm_version[S8_LEN_FIRMVER + 1];
+        int32_t sensor_id;
+        int32_t sensor_type_id;
+        int16_t map_version;
+        int16_t abc_period;
+        uint16_t crc;
+    };
+
+
+    /* Where identities are saved (callbacks, NVS of ESP32, EEPROM, ...) */
+    class S8_storage
+    {
+        public:
+            virtual ~S8_storage() {}
+
+            virtual bool load(int32_t sensor_id, S8_identity &identity) = 0;       // Load identity of a sensor (false if not saved)
+            virtual bool save(const S8_identity &identity) = 0;                     // Save identity (key is identity.sensor_id)
+    };
+
+
+    /* Storage with user functions */
+    typedef bool (*S8_identity_load)(int32_t sensor_id, S8_identity &identity);
+    typedef bool (*S8_identity_save)(const S8_identity &identity);
+
+    class S8_callback_storage : public S8_storage
+    {
+        public:
+            S8_callback_storage(S8_identity_load load_fn, S8_identity_save save_fn) : load_fn(load_fn), save_fn(save_fn) {}
+
+            bool load(int32_t sensor_id, S8_identity &identity) override { return load_fn != NULL && load_fn(sensor_id, identity); }
+            bool save(const S8_identity &identity) override { return save_fn != NULL && save_fn(identity); }
+
+        private:
+            S8_identity_load load_fn;
+            S8_identity_save save_fn;
+    };
+
+
+    #ifdef ARDUINO_ARCH_ESP32
+
+    #include <Preferences.h>
+
+    /* Storage in NVS of ESP32 (one key per sensor ID) */
+    class S8_nvs_storage : public S8_storage
+    {
+        public:
+            S8_nvs_storage(const char *name_space = "s8") : name_space(name_space) {}
+
+            bool load(int32_t sensor_id, S8_identity &identity) override;
+            bool save(const S8_identity &identity) override;
+
+        private:
+            const char *name_space;
+            Preferences prefs;
+    };
+
+    #endif
+
+
+    #if !defined(S8_HOST) && defined(__has_include)
+    #if __has_include(<EEPROM.h>)
+
+    #define S8_HAS_EEPROM_STORAGE
+
+    /*
+        Storage in EEPROM (or emulated EEPROM in flash), one sensor in sizeof(S8_identity) bytes from address
+
+        On cores with emulated EEPROM (ESP32, ESP8266, RP2040), EEPROM.begin() allocates a RAM copy of the flash
+        sector and reads it. It is called once, at the first load or save. If the sketch uses EEPROM too, call
+        EEPROM.begin() before with a size that includes address + sizeof(S8_identity).
+    */
+    class S8_eeprom_storage : public S8_storage
+    {
+        public:
+            S8_eeprom_storage(int address = 0) : address(address), started(false) {}
+
+            bool load(int32_t sensor_id, S8_identity &identity) override;
+            bool save(const S8_identity &identity) override;
+
+        private:
+            int address;
+            bool started;                                                           // EEPROM.begin() called (emulated EEPROM)
+
+            void begin();
+    };
+
+    #endif
+    #endif
+
+
+    /*
+        Identity of a sensor read only once
+
+        begin() reads the sensor ID (one transaction) and loads the saved identity of that sensor. If there is no
+        valid saved identity (first boot, another sensor), it reads firmware version, type ID, memory map version
+        and ABC period and saves them.
+    */
+    class S8_identity_store
+    {
+        public:
+            S8_identity_store(S8_UART &sensor, S8_storage &storage);
+
+            bool begin(S8_sensor &info);                                            // Fill identity of info (false if the sensor does not answer)
+            bool save(const S8_sensor &info);                                       // Save again (ex: after changing ABC period)
+
+            uint8_t transactions;                                                   // Transactions used by begin()
+            bool loaded;                                                            // Identity loaded from storage in begin()
+
+        private:
+            S8_UART* sensor;
+            S8_storage* storage;
+    };
+
+
+    bool S8_identity_valid(const S8_identity &identity);                           // Check version and CRC of saved identity
+    void S8_identity_seal(S8_identity &identity);                                  // Set version and CRC before saving
+
+#endif
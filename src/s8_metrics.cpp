@@ -0,0 +1,154 @@
+/***************************************************************************************************************************
+
+	SenseAir S8 OpenMetrics Exporter
+
+	Copyright (c) 2021 Josep Comas
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+	SOFTWARE.
+
+***************************************************************************************************************************/
+
+
+
+#include "s8_metrics.h"
+
+
+// Error bits of meter status
+static const struct { uint16_t mask; const char *name; } meter_errors[] = {
+    { S8_MASK_METER_FATAL_ERROR, "fatal" },
+    { S8_MASK_METER_OFFSET_REGULATION_ERROR, "offset_regulation" },
+    { S8_MASK_METER_ALGORITHM_ERROR, "algorithm" },
+    { S8_MASK_METER_OUTPUT_ERROR, "output" },
+    { S8_MASK_METER_SELF_DIAG_ERROR, "self_diagnostics" },
+    { S8_MASK_METER_OUT_OF_RANGE, "out_of_range" },
+    { S8_MASK_METER_MEMORY_ERROR, "memory" }
+};
+
+
+/* Header of a family (unit is optional) */
+static void family(S8_writer &out, const char *name, const char *type, const char *unit, const char *help) {
+    out.put("# TYPE "); out.put(name); out.put(' '); out.put(type); out.put('\n');
+    if (unit != NULL) {
+        out.put("# UNIT "); out.put(name); out.put(' '); out.put(unit); out.put('\n');
+    }
+    out.put("# HELP "); out.put(name); out.put(' '); out.put(help); out.put('\n');
+}
+
+
+/* Start of a sample, "name{sensor="..."" (labels are not closed) */
+static void sample(S8_writer &out, const char *name, const char *suffix, const S8_metrics_source &source) {
+    out.put(name);
+    if (suffix != NULL) {
+        out.put(suffix);
+    }
+    out.put("{sensor=\"");
+    out.put_escaped(source.name);
+    out.put('"');
+}
+
+
+/* Write state of sensors in OpenMetrics text format */
+void S8_write_openmetrics(S8_writer &out, const S8_metrics_source sources[], uint8_t count) {
+
+    family(out, "s8_co2_ppm", "gauge", "ppm", "CO2 concentration.");
+    for (uint8_t i = 0; i < count; i++) {
+        sample(out, "s8_co2_ppm", NULL, sources[i]);
+        out.put("} "); out.put_int(sources[i].sensor->co2); out.put('\n');
+    }
+
+    family(out, "s8_meter_error", "gauge", NULL, "Error bits of meter status.");
+    for (uint8_t i = 0; i < count; i++) {
+        for (uint8_t e = 0; e < sizeof(meter_errors) / sizeof(meter_errors[0]); e++) {
+            sample(out, "s8_meter_error", NULL, sources[i]);
+            out.put(",error=\""); out.put(meter_errors[e].name);
+            out.put((sources[i].sensor->meter_status & meter_errors[e].mask) ? "\"} 1\n" : "\"} 0\n");
+        }
+    }
+
+    family(out, "s8_sensor", "info", NULL, "Identity of the sensor.");
+    for (uint8_t i = 0; i < count; i++) {
+        const S8_sensor *sensor = sources[i].sensor;
+        sample(out, "s8_sensor", "_info", sources[i]);
+        out.put(",sensor_id=\""); out.put_hex(sensor->sensor_id, 8);
+        out.put("\",type_id=\""); out.put_hex(sensor->sensor_type_id, 6);
+        out.put("\",firmware=\""); out.put_escaped(sensor->firm_version);
+        out.put("\",map_version=\""); out.put_int(sensor->map_version);
+        out.put("\"} 1\n");
+    }
+
+    family(out, "s8_abc_period_hours", "gauge", "hours", "Period of automatic background calibration (0 = disabled).");
+    for (uint8_t i = 0; i < count; i++) {
+        sample(out, "s8_abc_period_hours", NULL, sources[i]);
+        out.put("} "); out.put_int(sources[i].sensor->abc_period); out.put('\n');
+    }
+
+    // Link
+    family(out, "s8_transactions", "counter", NULL, "Transactions with the sensor.");
+    for (uint8_t i = 0; i < count; i++) {
+        if (sources[i].link != NULL) {
+            sample(out, "s8_transactions", "_total", sources[i]);
+            out.put("} "); out.put_uint(sources[i].link->transactions); out.put('\n');
+        }
+    }
+
+    family(out, "s8_transaction_errors", "counter", NULL, "Transactions with an invalid response.");
+    for (uint8_t i = 0; i < count; i++) {
+        if (sources[i].link != NULL) {
+            sample(out, "s8_transaction_errors", "_total", sources[i]);
+            out.put("} "); out.put_uint(sources[i].link->errors); out.put('\n');
+        }
+    }
+
+    family(out, "s8_transaction_timeouts", "counter", NULL, "Transactions without a complete response.");
+    for (uint8_t i = 0; i < count; i++) {
+        if (sources[i].link != NULL) {
+            sample(out, "s8_transaction_timeouts", "_total", sources[i]);
+            out.put("} "); out.put_uint(sources[i].link->timeouts); out.put('\n');
+        }
+    }
+
+    family(out, "s8_discarded_bytes", "counter", "bytes", "Stale bytes before a request or garbage before a response.");
+    for (uint8_t i = 0; i < count; i++) {
+        if (sources[i].link != NULL) {
+            sample(out, "s8_discarded_bytes", "_total", sources[i]);
+            out.put("} "); out.put_uint(sources[i].link->discarded_bytes); out.put('\n');
+        }
+    }
+
+    family(out, "s8_transaction_latency_seconds", "summary", "seconds", "Time from request to end of transaction.");
+    for (uint8_t i = 0; i < count; i++) {
+        if (sources[i].link != NULL) {
+            sample(out, "s8_transaction_latency_seconds", "_count", sources[i]);
+            out.put("} "); out.put_uint(sources[i].link->transactions); out.put('\n');
+            sample(out, "s8_transaction_latency_seconds", "_sum", sources[i]);
+            out.put("} "); out.put_fixed(sources[i].link->total_latency_us, 6); out.put('\n');
+        }
+    }
+
+    family(out, "s8_transaction_latency_max_seconds", "gauge", "seconds", "Maximum time of a transaction.");
+    for (uint8_t i = 0; i < count; i++) {
+        if (sources[i].link != NULL) {
+            sample(out, "s8_transaction_latency_max_seconds", NULL, sources[i]);
+            out.put("} "); out.put_fixed(sources[i].link->max_latency_us, 6); out.put('\n');
+        }
+    }
+
+    out.put("# EOF\n");
+    out.flush();
+}
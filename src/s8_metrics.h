@@ -0,0 +1,52 @@
+/***************************************************************************************************************************
+
+	SenseAir S8 OpenMetrics Exporter
+
+	Copyright (c) 2021 Josep Comas
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+	SOFTWARE.
+
+***************************************************************************************************************************/
+
+
+
+#ifndef _S8_METRICS_H
+    #define _S8_METRICS_H
+
+    #include "s8_uart.h"
+    #include "s8_writer.h"
+
+
+    /* Data of a sensor to export */
+    struct S8_metrics_source {
+        const char *name;                   // Value of label sensor
+        const S8_sensor *sensor;            // Last data of the sensor
+        const S8_link_stats *link;          // Counters of the link (NULL = not exported)
+    };
+
+
+    /*
+        Write state of sensors in OpenMetrics (Prometheus) text format: CO2, error bits of meter status, identity,
+        ABC period and counters and latency of the link. Metrics of all sensors are grouped by family as the format
+        requires, it ends with "# EOF". Use an S8_writer with an output (Print, FILE) to stream big expositions
+        through a small buffer.
+    */
+    void S8_write_openmetrics(S8_writer &out, const S8_metrics_source sources[], uint8_t count);
+
+#endif
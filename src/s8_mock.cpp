@@ -0,0 +1,127 @@
+/***************************************************************************************************************************
+
+	SenseAir S8 Mock Device
+
+	Copyright (c) 2021 Josep Comas
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+	SOFTWARE.
+
+***************************************************************************************************************************/
+
+
+#include "s8_mock.h"
+#include "s8_uart.h"
+#include "modbus_crc.h"
+
+
+/* Initialize registers with plausible values */
+S8_mock_device::S8_mock_device() {
+    memset(input_regs, 0, sizeof(input_regs));
+    memset(holding_regs, 0, sizeof(holding_regs));
+
+    input_regs[MODBUS_IR4] = 400;           // CO2
+    input_regs[MODBUS_IR22] = 3277;         // PWM output (400 ppm)
+    input_regs[MODBUS_IR26] = 0x0001;       // Sensor type ID
+    input_regs[MODBUS_IR27] = 0x0203;
+    input_regs[MODBUS_IR28] = 0x0001;       // Memory map version
+    input_regs[MODBUS_IR29] = 0x0103;       // Firmware version 1.3
+    input_regs[MODBUS_IR30] = 0x0A0B;       // Sensor ID
+    input_regs[MODBUS_IR31] = 0x0C0D;
+    holding_regs[MODBUS_HR32] = 180;        // ABC period
+}
+
+
+/* Build the response of a request */
+uint8_t S8_mock_device::process(const uint8_t *request, uint8_t size, uint8_t *response) {
+    uint16_t crc16;
+    uint8_t nb = 0;
+
+    if (size != 8 || request[0] != MODBUS_ANY_ADDRESS) {
+        return 0;
+    }
+
+    crc16 = modbus_CRC16((uint8_t *)request, 6);
+    if (request[6] != (crc16 & 0x00FF) || request[7] != ((crc16 >> 8) & 0x00FF)) {
+        return 0;
+    }
+
+    uint8_t func = request[1];
+    uint16_t reg = (request[2] << 8) | request[3];
+    uint16_t value = (request[4] << 8) | request[5];
+
+    if (func == MODBUS_FUNC_READ_INPUT_REGISTERS || func == MODBUS_FUNC_READ_HOLDING_REGISTERS) {
+        uint16_t *regs = (func == MODBUS_FUNC_READ_INPUT_REGISTERS) ? input_regs : holding_regs;
+
+        if (value == 0 || reg + value > S8_MOCK_REGISTERS || 5 + value * 2 > S8_MOCK_LEN_FRAME) {
+            return 0;
+        }
+
+        response[nb++] = MODBUS_ANY_ADDRESS;
+        response[nb++] = func;
+        response[nb++] = value * 2;
+        for (uint16_t i = 0; i < value; i++) {
+            response[nb++] = (regs[reg + i] >> 8) & 0x00FF;
+            response[nb++] = regs[reg + i] & 0x00FF;
+        }
+
+    } else if (func == MODBUS_FUNC_WRITE_SINGLE_REGISTER) {
+
+        if (reg >= S8_MOCK_REGISTERS) {
+            return 0;
+        }
+
+        holding_regs[reg] = value;
+
+        // Background calibration is done immediately
+        if (reg == MODBUS_HR2 && value == S8_CO2_BACKGROUND_CALIBRATION) {
+            holding_regs[MODBUS_HR1] |= S8_MASK_CO2_BACKGROUND_CALIBRATION;
+        }
+
+        memcpy(response, request, 8);       // Echo
+        return 8;
+
+    } else {
+        return 0;
+    }
+
+    crc16 = modbus_CRC16(response, nb);
+    response[nb++] = crc16 & 0x00FF;
+    response[nb++] = (crc16 >> 8) & 0x00FF;
+
+    return nb;
+}
+
+
+/* Answer is ready as soon as the request is written */
+uint8_t S8_mock_transport::write(const uint8_t *buf, uint8_t size) {
+    rx_len = device->process(buf, size, rx_buf);
+    rx_pos = 0;
+    return size;
+}
+
+
+uint8_t S8_mock_transport::read(uint8_t *buf, uint8_t max_bytes) {
+    uint8_t nb = 0;
+
+    while (nb < max_bytes && rx_pos < rx_len) {
+        buf[nb++] = rx_buf[rx_pos++];
+    }
+
+    return nb;
+}
@@ -0,0 +1,70 @@
+/***************************************************************************************************************************
+
+	SenseAir S8 Mock Device
+
+	Copyright (c) 2021 Josep Comas
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+	SOFTWARE.
+
+***************************************************************************************************************************/
+
+
+#ifndef _S8_MOCK_H
+    #define _S8_MOCK_H
+
+    #include "s8_transport.h"
+    #include "s8_registers.h"
+
+
+    #define S8_MOCK_REGISTERS   32      // Number of input and holding registers emulated
+    #define S8_MOCK_LEN_FRAME   80      // Max length of a frame
+
+
+    /* Register model of an S8 answering Modbus requests (used by the mock transport and the emulators) */
+    class S8_mock_device
+    {
+        public:
+            S8_mock_device();
+
+            uint16_t input_regs[S8_MOCK_REGISTERS];                                 // IR1 = input_regs[0] ...
+            uint16_t holding_regs[S8_MOCK_REGISTERS];                               // HR1 = holding_regs[0] ...
+
+            uint8_t process(const uint8_t *request, uint8_t size, uint8_t *response);  // Build response to a request (returns length, 0 = no answer)
+    };
+
+
+    /* Transport answering requests from a mock device, without any serial port */
+    class S8_mock_transport : public S8_transport
+    {
+        public:
+            S8_mock_transport(S8_mock_device &device) : device(&device), rx_len(0), rx_pos(0) {}
+
+            uint8_t write(const uint8_t *buf, uint8_t size) override;
+            void flush() override {}
+            int available() override { return rx_len - rx_pos; }
+            uint8_t read(uint8_t *buf, uint8_t max_bytes) override;
+
+        private:
+            S8_mock_device* device;
+            uint8_t rx_buf[S8_MOCK_LEN_FRAME];
+            uint8_t rx_len;
+            uint8_t rx_pos;
+    };
+
+#endif
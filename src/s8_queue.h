@@ -0,0 +1,119 @@
+/***************************************************************************************************************************
+
+	SenseAir S8 Lock-free Queue
+
+	Copyright (c) 2021 Josep Comas
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+	SOFTWARE.
+
+***************************************************************************************************************************/
+
+
+
+#ifndef _S8_QUEUE_H
+    #define _S8_QUEUE_H
+
+    #include <stdint.h>
+
+    #if defined(__has_include)
+        #if __has_include(<atomic>)
+            #include <atomic>
+            #define S8_QUEUE_ATOMIC
+        #endif
+    #endif
+
+
+    /*
+        Lock-free queue for one producer and one consumer (ex: sensor task in one core, application in the other)
+
+        Only the producer writes head and only the consumer writes tail, so no lock is needed. With <atomic> the
+        indexes are published with release/acquire order (the item is visible before the index). Without it
+        (AVR) the indexes are one byte volatile, enough for a single core with the producer in an interrupt.
+        SIZE must be a power of two.
+    */
+    template <class T, uint16_t SIZE>
+    class S8_spsc_queue
+    {
+        static_assert(SIZE >= 2 && (SIZE & (SIZE - 1)) == 0, "Size of the queue must be a power of two");
+
+        public:
+        #ifdef S8_QUEUE_ATOMIC
+            typedef uint16_t index_type;
+        #else
+            static_assert(SIZE <= 128, "Size of the queue must be 128 or less without <atomic>");
+            typedef uint8_t index_type;
+        #endif
+
+            S8_spsc_queue() : overruns(0), head(0), tail(0) {}
+
+            /* Add an item (producer only), false if the queue is full */
+            bool push(const T &item) {
+                index_type h = load_relaxed(head);
+
+                if ((index_type)(h - load_acquire(tail)) == SIZE) {
+                    overruns++;
+                    return false;
+                }
+
+                items[h & (SIZE - 1)] = item;
+                store_release(head, h + 1);
+                return true;
+            }
+
+            /* Take the oldest item (consumer only), false if the queue is empty */
+            bool pop(T &item) {
+                index_type t = load_relaxed(tail);
+
+                if (t == load_acquire(head)) {
+                    return false;
+                }
+
+                item = items[t & (SIZE - 1)];
+                store_release(tail, t + 1);
+                return true;
+            }
+
+            /* Number of items (approximate if the other side is working) */
+            uint16_t size() { return (index_type)(load_acquire(head) - load_acquire(tail)); }
+
+            bool empty() { return size() == 0; }
+
+            uint32_t overruns;                                                      // Items lost because the queue was full (written by producer)
+
+        private:
+        #ifdef S8_QUEUE_ATOMIC
+            typedef std::atomic<index_type> index_var;
+
+            static index_type load_relaxed(index_var &v) { return v.load(std::memory_order_relaxed); }
+            static index_type load_acquire(index_var &v) { return v.load(std::memory_order_acquire); }
+            static void store_release(index_var &v, index_type value) { v.store(value, std::memory_order_release); }
+        #else
+            typedef volatile index_type index_var;
+
+            static index_type load_relaxed(index_var &v) { return v; }
+            static index_type load_acquire(index_var &v) { index_type value = v; __asm__ __volatile__("" ::: "memory"); return value; }
+            static void store_release(index_var &v, index_type value) { __asm__ __volatile__("" ::: "memory"); v = value; }
+        #endif
+
+            index_var head;                                                         // Next item to write
+            index_var tail;                                                         // Next item to read
+            T items[SIZE];
+    };
+
+#endif
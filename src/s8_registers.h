@@ -0,0 +1,152 @@
+/***************************************************************************************************************************
+
+	SenseAir S8 Register Map
+
+	Copyright (c) 2021 Josep Comas
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+	SOFTWARE.
+
+***************************************************************************************************************************/
+
+
+#ifndef _S8_REGISTERS_H
+    #define _S8_REGISTERS_H
+
+    #include <stdint.h>
+
+
+    // Modbus
+    #define MODBUS_ANY_ADDRESS                  0XFE    // S8 uses any address
+    #define MODBUS_FUNC_READ_HOLDING_REGISTERS  0X03    // Read holding registers (HR)
+    #define MODBUS_FUNC_READ_INPUT_REGISTERS    0x04    // Read input registers (IR)
+    #define MODBUS_FUNC_WRITE_SINGLE_REGISTER   0x06    // Write single register (SR)
+
+
+    // Input registers for S8
+    #define MODBUS_IR1             0x0000  // MeterStatus
+    #define MODBUS_IR2             0x0001  // AlarmStatus
+    #define MODBUS_IR3             0x0002  // OutputStatus
+    #define MODBUS_IR4             0x0003  // Space CO2
+    #define MODBUS_IR22            0x0015  // PWM Output
+    #define MODBUS_IR26            0x0019  // Sensor Type ID High
+    #define MODBUS_IR27            0x001A  // Sensor Type ID Low
+    #define MODBUS_IR28            0x001B  // Memory Map version
+    #define MODBUS_IR29            0x001C  // FW version Main.Sub
+    #define MODBUS_IR30            0x001D  // Sensor ID High
+    #define MODBUS_IR31            0x001E  // Sensor ID Low
+
+
+    // Holding registers for S8
+    #define MODBUS_HR1             0x0000  // Acknowledgement Register
+    #define MODBUS_HR2             0x0001  // Special Command Register
+    #define MODBUS_HR32            0x001F  // ABC Period
+
+
+    /*
+        Register descriptors
+
+        Every register (or group of consecutive registers holding one value) is described at compile time by
+        its function code, address, number of words, width in bits, signedness and scaling. The decoders are
+        generated from the descriptor, so getters and multi-register reads share the same decoding code and
+        there is no runtime lookup.
+    */
+
+    // Type used to return a value of one or two words
+    template <uint8_t WORDS> struct S8_reg_value { typedef int32_t type; };
+    template <> struct S8_reg_value<1> { typedef int16_t type; };
+
+
+    template <uint8_t FUNC, uint16_t ADDR, uint8_t WORDS, uint8_t BITS, bool SIGNED,
+              int32_t SCALE_NUM = 1, int32_t SCALE_DEN = 1>
+    struct S8_register {
+        static_assert(FUNC == MODBUS_FUNC_READ_INPUT_REGISTERS || FUNC == MODBUS_FUNC_READ_HOLDING_REGISTERS, "Invalid register type");
+        static_assert(WORDS >= 1 && WORDS <= 2, "A value uses one or two words");
+        static_assert(BITS >= 1 && BITS <= WORDS * 16, "Width does not fit in the words of the register");
+        static_assert(SCALE_DEN != 0, "Invalid scaling");
+
+        typedef typename S8_reg_value<WORDS>::type value_type;
+
+        static constexpr uint8_t func = FUNC;                   // Function code to read it
+        static constexpr uint16_t addr = ADDR;                  // Address of first word
+        static constexpr uint8_t words = WORDS;                 // Number of words
+        static constexpr uint32_t mask = (BITS >= 32) ? 0xFFFFFFFFul : ((1ul << (BITS % 32)) - 1);
+
+        /* Decode value from data bytes of a response (big endian words) */
+        static value_type decode(const uint8_t *data) {
+            uint32_t raw = 0;
+
+            for (uint8_t i = 0; i < WORDS * 2; i++) {
+                raw = (raw << 8) | data[i];
+            }
+            raw &= mask;
+
+            if (SIGNED && BITS < 32 && (raw & ((mask >> 1) + 1))) {
+                raw |= ~mask;   // Sign extension
+            }
+
+            return (value_type)raw;
+        }
+
+        /* Scale a raw value to engineering units */
+        static int32_t scale(value_type raw) {
+            return ((int32_t)raw * SCALE_NUM) / SCALE_DEN;
+        }
+    };
+
+
+    /*
+        Block of consecutive registers of the same type read in one transaction (from FIRST to LAST, both included).
+        The offset of every register inside the response is resolved at compile time.
+    */
+    template <class FIRST, class LAST>
+    struct S8_block {
+        static_assert(FIRST::func == LAST::func, "Registers of a block must be of the same type");
+        static_assert(LAST::addr >= FIRST::addr, "Registers of a block must be in ascending order");
+
+        static constexpr uint8_t func = FIRST::func;
+        static constexpr uint16_t addr = FIRST::addr;
+        static constexpr uint8_t words = LAST::addr + LAST::words - FIRST::addr;
+
+        /* Decode a register from data bytes of the block response */
+        template <class REG>
+        static typename REG::value_type decode(const uint8_t *data) {
+            static_assert(REG::func == func, "Register type differs from block type");
+            static_assert(REG::addr >= addr && REG::addr + REG::words <= addr + words, "Register outside of block");
+            return REG::decode(data + (REG::addr - addr) * 2);
+        }
+    };
+
+
+    // Input registers
+    typedef S8_register<MODBUS_FUNC_READ_INPUT_REGISTERS, MODBUS_IR1, 1, 16, false> S8_reg_meter_status;
+    typedef S8_register<MODBUS_FUNC_READ_INPUT_REGISTERS, MODBUS_IR2, 1, 16, false> S8_reg_alarm_status;
+    typedef S8_register<MODBUS_FUNC_READ_INPUT_REGISTERS, MODBUS_IR3, 1, 16, false> S8_reg_output_status;
+    typedef S8_register<MODBUS_FUNC_READ_INPUT_REGISTERS, MODBUS_IR4, 1, 16, true> S8_reg_co2;
+    typedef S8_register<MODBUS_FUNC_READ_INPUT_REGISTERS, MODBUS_IR22, 1, 16, false, 2000, 16383> S8_reg_pwm_output;   // Scaled to ppm (normal version)
+    typedef S8_register<MODBUS_FUNC_READ_INPUT_REGISTERS, MODBUS_IR26, 2, 24, false> S8_reg_sensor_type_id;           // IR26 (low byte) + IR27
+    typedef S8_register<MODBUS_FUNC_READ_INPUT_REGISTERS, MODBUS_IR28, 1, 16, false> S8_reg_memory_map_version;
+    typedef S8_register<MODBUS_FUNC_READ_INPUT_REGISTERS, MODBUS_IR29, 1, 16, false> S8_reg_firmware_version;         // Main (high byte).Sub (low byte)
+    typedef S8_register<MODBUS_FUNC_READ_INPUT_REGISTERS, MODBUS_IR30, 2, 32, false> S8_reg_sensor_id;                // IR30 + IR31
+
+    // Holding registers
+    typedef S8_register<MODBUS_FUNC_READ_HOLDING_REGISTERS, MODBUS_HR1, 1, 16, false> S8_reg_acknowledgement;
+    typedef S8_register<MODBUS_FUNC_READ_HOLDING_REGISTERS, MODBUS_HR2, 1, 16, false> S8_reg_special_command;
+    typedef S8_register<MODBUS_FUNC_READ_HOLDING_REGISTERS, MODBUS_HR32, 1, 16, false> S8_reg_abc_period;
+
+#endif
@@ -0,0 +1,199 @@
+/***************************************************************************************************************************
+
+	SenseAir S8 Sensor Task
+
+	Copyright (c) 2021 Josep Comas
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+	SOFTWARE.
+
+***************************************************************************************************************************/
+
+
+
+#include "s8_runner.h"
+#include "utils.h"
+
+#ifdef ARDUINO_ARCH_RP2040
+    #include "pico/multicore.h"
+#endif
+
+
+S8_runner::S8_runner() {
+    count = 0;
+    period_ms = 2000;
+#ifdef ARDUINO_ARCH_ESP32
+    task = NULL;
+#endif
+}
+
+
+/* Add a sensor (before begin) */
+int8_t S8_runner::add(S8_UART &sensor) {
+
+    if (count == S8_RUNNER_MAX_SENSORS) {
+        LOG_DEBUG_ERROR("Too many sensors!");
+        return -1;
+    }
+
+    sensors[count] = &sensor;
+    memset(&last[count], 0, sizeof(S8_sensor));
+    identified[count] = false;
+
+    return count++;
+}
+
+
+/* Read identity of a sensor (first cycle or after errors) */
+void S8_runner::identify(uint8_t i) {
+
+    sensors[i]->get_firmware_version(last[i].firm_version);
+    last[i].sensor_id = sensors[i]->get_sensor_ID();
+    identified[i] = (strlen(last[i].firm_version) > 0);
+}
+
+
+/* Read all sensors once and publish samples */
+void S8_runner::run_once() {
+
+    bool pending[S8_RUNNER_MAX_SENSORS];
+    uint8_t waiting = 0;
+
+    for (uint8_t i = 0; i < count; i++) {
+        if (!identified[i]) {
+            identify(i);
+        }
+    }
+
+    // Requests to all ports at the same time
+    for (uint8_t i = 0; i < count; i++) {
+        pending[i] = sensors[i]->request_read<block>();
+        if (pending[i]) {
+            waiting++;
+        }
+    }
+
+    while (waiting > 0) {
+        for (uint8_t i = 0; i < count; i++) {
+
+            if (!pending[i]) {
+                continue;
+            }
+
+            uint8_t status = sensors[i]->poll_transaction();
+            if (status == S8_TRANSACTION_PENDING) {
+                continue;
+            }
+
+            pending[i] = false;
+            waiting--;
+
+            if (status == S8_TRANSACTION_DONE) {
+                const uint8_t *data = sensors[i]->response_data();
+                last[i].meter_status = block::decode<S8_reg_meter_status>(data);
+                last[i].alarm_status = block::decode<S8_reg_alarm_status>(data);
+                last[i].output_status = block::decode<S8_reg_output_status>(data);
+                last[i].co2 = block::decode<S8_reg_co2>(data);
+            } else {
+                identified[i] = false;      // Sensor could be replaced
+            }
+
+            S8_sample sample;
+            sample.time = millis();
+            sample.sensor = i;
+            sample.status = status;
+            sample.data = last[i];
+            queue.push(sample);
+        }
+
+        if (waiting > 0) {
+            delay(1);   // Other tasks of this core can run
+        }
+    }
+}
+
+
+/* Loop of the task */
+void S8_runner::run() {
+
+    uint32_t next = millis();
+
+    while (true) {
+        run_once();
+
+        next += period_ms;
+        int32_t wait = (int32_t)(next - millis());
+        if (wait > 0) {
+            delay(wait);
+        } else {
+            next = millis();    // Too slow, don't try to catch up
+        }
+    }
+}
+
+
+#ifdef ARDUINO_ARCH_ESP32
+
+void S8_runner::task_entry(void *param) {
+    ((S8_runner *)param)->run();
+}
+
+
+/* Start task pinned to core */
+bool S8_runner::begin(uint32_t period_ms, BaseType_t core, uint32_t stack, UBaseType_t priority) {
+
+    if (task != NULL) {
+        return false;
+    }
+
+    this->period_ms = period_ms;
+
+    if (xTaskCreatePinnedToCore(task_entry, "s8_runner", stack, this, priority, &task, core) != pdPASS) {
+        LOG_DEBUG_ERROR("Error creating task!");
+        task = NULL;
+        return false;
+    }
+
+    return true;
+}
+
+#elif defined(ARDUINO_ARCH_RP2040)
+
+S8_runner *S8_runner::core1_runner = NULL;
+
+
+void S8_runner::core1_entry() {
+    core1_runner->run();
+}
+
+
+/* Start in core 1 */
+bool S8_runner::begin(uint32_t period_ms) {
+
+    if (core1_runner != NULL) {
+        return false;
+    }
+
+    this->period_ms = period_ms;
+    core1_runner = this;
+    multicore_launch_core1(core1_entry);
+
+    return true;
+}
+
+#endif
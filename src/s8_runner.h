@@ -0,0 +1,102 @@
+/***************************************************************************************************************************
+
+	SenseAir S8 Sensor Task
+
+	Copyright (c) 2021 Josep Comas
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+	SOFTWARE.
+
+***************************************************************************************************************************/
+
+
+
+#ifndef _S8_RUNNER_H
+    #define _S8_RUNNER_H
+
+    #include "s8_uart.h"
+    #include "s8_queue.h"
+
+    #ifdef ARDUINO_ARCH_ESP32
+        #include "freertos/FreeRTOS.h"
+        #include "freertos/task.h"
+    #endif
+
+
+    #define S8_RUNNER_MAX_SENSORS   4       // Max sensors owned by a runner
+    #define S8_RUNNER_QUEUE_SIZE   16       // Samples in the queue (power of two)
+
+
+    /* Snapshot of a sensor */
+    struct S8_sample {
+        uint32_t time;                      // millis() when the response was received
+        uint8_t sensor;                     // Index of the sensor in the runner
+        uint8_t status;                     // S8_TRANSACTION_DONE or error (data is the last valid one)
+        S8_sensor data;                     // Identity, CO2 and status bits
+    };
+
+
+    /*
+        Sensor I/O in a dedicated task (ESP32, FreeRTOS task pinned to a core) or in the second core (RP2040)
+
+        The task owns the S8_UART instances: every period it reads meter, alarm and output status and CO2 of all
+        sensors (one transaction per sensor, all ports at the same time) and pushes a timestamped S8_sample to a
+        lock-free queue. The application takes samples with pop() and never waits for the UART. After begin(),
+        sensors must not be used from other tasks.
+    */
+    class S8_runner
+    {
+        public:
+            S8_runner();
+
+            int8_t add(S8_UART &sensor);                                            // Add a sensor (returns index or -1)
+            void run_once();                                                        // Read all sensors once and publish samples (blocks)
+
+        #ifdef ARDUINO_ARCH_ESP32
+            bool begin(uint32_t period_ms = 2000, BaseType_t core = 0,
+                       uint32_t stack = 4096, UBaseType_t priority = 1);            // Start task pinned to core
+        #elif defined(ARDUINO_ARCH_RP2040)
+            bool begin(uint32_t period_ms = 2000);                                  // Start in core 1 (do not use setup1/loop1)
+        #endif
+
+            bool pop(S8_sample &sample) { return queue.pop(sample); }               // Take next sample (application side)
+            uint32_t dropped() { return queue.overruns; }                           // Samples lost (application too slow)
+
+        private:
+            S8_UART* sensors[S8_RUNNER_MAX_SENSORS];
+            S8_sensor last[S8_RUNNER_MAX_SENSORS];
+            bool identified[S8_RUNNER_MAX_SENSORS];
+            uint8_t count;
+            uint32_t period_ms;
+            S8_spsc_queue<S8_sample, S8_RUNNER_QUEUE_SIZE> queue;
+
+            typedef S8_block<S8_reg_meter_status, S8_reg_co2> block;
+
+            void identify(uint8_t i);
+            void run();
+
+        #ifdef ARDUINO_ARCH_ESP32
+            TaskHandle_t task;
+            static void task_entry(void *param);
+        #elif defined(ARDUINO_ARCH_RP2040)
+            static S8_runner *core1_runner;
+            static void core1_entry();
+        #endif
+    };
+
+#endif
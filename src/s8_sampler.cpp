@@ -0,0 +1,218 @@
+/***************************************************************************************************************************
+
+	SenseAir S8 Periodic Sampler
+
+	Copyright (c) 2021 Josep Comas
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+	SOFTWARE.
+
+***************************************************************************************************************************/
+
+
+#include "s8_sampler.h"
+
+
+S8_sampler::S8_sampler(S8_UART &sensor) {
+    this->sensor = &sensor;
+    co2_callback = NULL;
+    status_callback = NULL;
+    error_callback = NULL;
+    anomaly = NULL;
+    period_ms = S8_MEASUREMENT_PERIOD;
+    cycles_per_read = 1;
+    co2 = 0;
+    meter_status = 0;
+    begin();
+}
+
+
+void S8_sampler::set_period(uint32_t period_ms) {
+    if (period_ms > 0) {
+        this->period_ms = period_ms;
+    }
+}
+
+
+void S8_sampler::set_interval(uint32_t interval_ms) {
+    uint32_t cycles = (interval_ms + period_ms / 2) / period_ms;
+    cycles_per_read = (cycles < 1) ? 1 : (cycles > 255 ? 255 : cycles);
+}
+
+
+/* Search phase of measurements */
+void S8_sampler::begin() {
+    state = SAMPLER_SYNC;
+    pending = false;
+    pwm_due = false;
+    pwm_pending = false;
+    pwm_reads = 0;
+    have_value = false;
+    have_phase = false;
+    reads = 0;
+    next_read = millis();
+    sync_start = next_read;
+    sync_limit = S8_SAMPLER_SYNC_CYCLES * period_ms;
+}
+
+
+void S8_sampler::tick() {
+    uint32_t now = millis();
+
+    if (pending) {
+        uint8_t status = sensor->poll_transaction();
+
+        if (status != S8_TRANSACTION_PENDING) {
+            pending = false;
+
+            if (pwm_pending) {
+                pwm_pending = false;
+                pwm_due = false;
+                if (status == S8_TRANSACTION_DONE && anomaly != NULL) {
+                    anomaly->add_pwm(sensor->response_value<S8_reg_pwm_output>());
+                } else if (status != S8_TRANSACTION_DONE && error_callback != NULL) {
+                    error_callback(status);
+                }
+
+            } else if (status == S8_TRANSACTION_DONE) {
+                process(now);
+
+            } else {
+                if (error_callback != NULL) {
+                    error_callback(status);
+                }
+
+                if (state == SAMPLER_SYNC) {
+                    next_read = now + S8_SAMPLER_SYNC_INTERVAL;
+                } else {
+                    schedule(now);
+                }
+            }
+        }
+
+    } else if (pwm_due) {
+
+        // Just after the CO2 value, same measurement
+        pwm_pending = pending = sensor->request_read<S8_reg_pwm_output>();
+        pwm_due = pending;
+
+    } else if ((int32_t)(now - next_read) >= 0) {
+
+        if (sensor->request_read<block>()) {
+            pending = true;
+        } else {
+            next_read = now + S8_SAMPLER_SYNC_INTERVAL;
+        }
+    }
+}
+
+
+/* New reading of meter status and CO2 */
+void S8_sampler::process(uint32_t now) {
+    const uint8_t *data = sensor->response_data();
+    int16_t value = block::decode<S8_reg_co2>(data);
+    int16_t status = block::decode<S8_reg_meter_status>(data);
+
+    if (!have_value || status != meter_status) {
+        meter_status = status;
+        if (status_callback != NULL) {
+            status_callback(meter_status);
+        }
+    }
+
+    if (state == SAMPLER_LOCKED) {
+        publish(now, value);
+
+        if (anomaly != NULL && ++pwm_reads >= S8_SAMPLER_PWM_CYCLES) {
+            pwm_reads = 0;
+            pwm_due = true;
+        }
+
+        // Check phase again from time to time, the clocks drift
+        if (++reads >= S8_SAMPLER_RESYNC_CYCLES) {
+            state = SAMPLER_SYNC;
+            reads = 0;
+            next_update += period_ms;
+            next_read = next_update - 2 * S8_SAMPLER_SYNC_INTERVAL;
+            sync_start = now;
+            sync_limit = period_ms + 4 * S8_SAMPLER_SYNC_INTERVAL;
+            if ((int32_t)(next_read - now) < 0) {
+                next_read = now;
+            }
+        } else {
+            schedule(now);
+        }
+        return;
+    }
+
+    // Searching phase, the first value is used to detect the change of measurement
+    if (reads++ == 0) {
+        baseline = value;
+
+        if (!have_value) {
+            publish(now, value);
+        }
+        have_value = true;
+        next_read = now + S8_SAMPLER_SYNC_INTERVAL;
+
+    } else if (value != baseline) {
+        publish(now, value);
+        lock(now, now - S8_SAMPLER_SYNC_INTERVAL / 2);      // Updated between last two reads
+
+    } else if ((now - sync_start) >= sync_limit) {
+        lock(now, have_phase ? next_update : now - S8_SAMPLER_MARGIN);    // Stable value, keep phase
+
+    } else {
+        next_read = now + S8_SAMPLER_SYNC_INTERVAL;
+    }
+}
+
+
+/* New CO2 value to callback and anomaly detector */
+void S8_sampler::publish(uint32_t now, int16_t value) {
+    co2 = value;
+
+    if (anomaly != NULL) {
+        anomaly->add(now, co2, meter_status);
+    }
+    if (co2_callback != NULL) {
+        co2_callback(co2);
+    }
+}
+
+
+/* Phase of measurements is known */
+void S8_sampler::lock(uint32_t now, uint32_t update_time) {
+    state = SAMPLER_LOCKED;
+    have_phase = true;
+    reads = 0;
+    next_update = update_time;
+    schedule(now);
+}
+
+
+/* Next read just after the update of the measurement, skipping measurements according to interval */
+void S8_sampler::schedule(uint32_t now) {
+    uint32_t step = period_ms * cycles_per_read;
+
+    do {
+        next_update += step;
+    } while ((int32_t)(next_update + S8_SAMPLER_MARGIN - now) <= 0);
+
+    next_read = next_update + S8_SAMPLER_MARGIN;
+}
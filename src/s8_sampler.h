@@ -0,0 +1,108 @@
+/***************************************************************************************************************************
+
+	SenseAir S8 Periodic Sampler
+
+	Copyright (c) 2021 Josep Comas
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+	SOFTWARE.
+
+***************************************************************************************************************************/
+
+
+#ifndef _S8_SAMPLER_H
+    #define _S8_SAMPLER_H
+
+    #include "s8_uart.h"
+    #include "s8_anomaly.h"
+
+
+    #define S8_MEASUREMENT_PERIOD       2000ul   // Measurement period of the sensor (lamp cycle) in milliseconds
+    #define S8_SAMPLER_SYNC_INTERVAL     250ul   // Interval of reads while searching the phase of measurements
+    #define S8_SAMPLER_MARGIN            100ul   // Delay of the read after the expected update of the measurement
+    #define S8_SAMPLER_SYNC_CYCLES         5     // Max measurement periods searching the phase at start
+    #define S8_SAMPLER_RESYNC_CYCLES      30     // Reads between checks of the phase (drift between clocks)
+    #define S8_SAMPLER_PWM_CYCLES         15     // Reads between checks of PWM output (with anomaly detector)
+
+
+    typedef void (*S8_co2_callback)(int16_t co2);                                   // New CO2 measure
+    typedef void (*S8_status_callback)(int16_t meter_status);                       // Meter status changed
+    typedef void (*S8_error_callback)(uint8_t status);                              // Transaction failed (S8_TRANSACTION_xxx)
+
+
+    /*
+        Sampler called from loop() with tick(), it never blocks
+
+        It searches the phase of the measurement cycle (reads every S8_SAMPLER_SYNC_INTERVAL until the value
+        changes), then it reads meter status and CO2 (IR1-IR4, one transaction) once per measurement, just after
+        the sensor updates it. Callbacks are only called for new data. An anomaly detector gets every new value
+        and, from time to time, the PWM output (IR22) read just after the CO2 value.
+    */
+    class S8_sampler
+    {
+        public:
+            S8_sampler(S8_UART &sensor);
+
+            void set_period(uint32_t period_ms);                                    // Measurement period of the sensor (default 2 seconds)
+            void set_interval(uint32_t interval_ms);                                // Interval of readings (rounded to measurement periods)
+            void on_co2(S8_co2_callback callback) { co2_callback = callback; }
+            void on_status_change(S8_status_callback callback) { status_callback = callback; }
+            void on_error(S8_error_callback callback) { error_callback = callback; }
+            void set_anomaly(S8_anomaly *anomaly) { this->anomaly = anomaly; }      // Detector fed with readings (NULL to disable)
+
+            void begin();                                                           // Start (search phase again)
+            void tick();                                                            // Call it from loop()
+
+            bool locked() { return state == SAMPLER_LOCKED; }                      // Phase of measurements is known
+            int16_t co2;                                                            // Last CO2 value
+            int16_t meter_status;                                                   // Last meter status
+
+        private:
+            enum { SAMPLER_SYNC, SAMPLER_LOCKED };
+
+            typedef S8_block<S8_reg_meter_status, S8_reg_co2> block;
+
+            S8_UART *sensor;
+            S8_co2_callback co2_callback;
+            S8_status_callback status_callback;
+            S8_error_callback error_callback;
+            S8_anomaly *anomaly;
+
+            uint32_t period_ms;
+            uint8_t cycles_per_read;
+            uint8_t state;
+            bool pending;
+            bool pwm_due;                                                           // Read PWM output before next measurement
+            bool pwm_pending;                                                       // Pending transaction is the PWM output
+            uint8_t pwm_reads;
+            bool have_value;
+            bool have_phase;
+            uint8_t reads;
+            int16_t baseline;
+            uint32_t next_read;
+            uint32_t next_update;                                                   // Expected time of next update of measurement
+            uint32_t sync_start;
+            uint32_t sync_limit;
+
+            void process(uint32_t now);
+            void publish(uint32_t now, int16_t value);
+            void lock(uint32_t now, uint32_t update_time);
+            void schedule(uint32_t now);
+    };
+
+#endif
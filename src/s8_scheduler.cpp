@@ -0,0 +1,267 @@
+/***************************************************************************************************************************
+
+	SenseAir S8 Transaction Scheduler
+
+	Copyright (c) 2021 Josep Comas
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+	SOFTWARE.
+
+***************************************************************************************************************************/
+
+
+#include "s8_scheduler.h"
+
+
+S8_scheduler::S8_scheduler(S8_UART &sensor) {
+    this->sensor = &sensor;
+
+    for (uint8_t i = 0; i < S8_SCHEDULER_MAX_JOBS; i++) {
+        jobs[i].active = false;
+    }
+
+    batch = 0;
+    transactions = 0;
+    jobs_done = 0;
+    deadline_misses = 0;
+    busy_ms = 0;
+    start_ms = millis();
+}
+
+
+int8_t S8_scheduler::add_read(uint8_t func, uint16_t reg, uint8_t words, uint32_t period_ms, S8_job_callback callback,
+                              uint32_t deadline_ms, uint8_t priority) {
+    Job job;
+
+    if (words == 0 || words > S8_SCHEDULER_MAX_WORDS ||
+        (func != MODBUS_FUNC_READ_INPUT_REGISTERS && func != MODBUS_FUNC_READ_HOLDING_REGISTERS)) {
+        LOG_DEBUG_ERROR("Invalid job!");
+        return -1;
+    }
+
+    job.func = func;
+    job.reg = reg;
+    job.words = words;
+    job.value = 0;
+    job.priority = priority;
+    job.period_ms = period_ms;
+    job.deadline_ms = (deadline_ms > 0) ? deadline_ms : (period_ms > 0 ? period_ms : S8_TIMEOUT);
+    job.callback = callback;
+
+    return add(job);
+}
+
+
+int8_t S8_scheduler::add_write(uint16_t reg, uint16_t value, S8_job_callback callback, uint32_t deadline_ms, uint8_t priority) {
+    Job job;
+
+    job.func = MODBUS_FUNC_WRITE_SINGLE_REGISTER;
+    job.reg = reg;
+    job.words = 1;
+    job.value = value;
+    job.priority = priority;
+    job.period_ms = 0;
+    job.deadline_ms = deadline_ms;
+    job.callback = callback;
+
+    return add(job);
+}
+
+
+/* Save job in a free slot, it is released now */
+int8_t S8_scheduler::add(Job &job) {
+    for (uint8_t i = 0; i < S8_SCHEDULER_MAX_JOBS; i++) {
+        if (!jobs[i].active && !(batch & (1 << i))) {
+            jobs[i] = job;
+            jobs[i].active = true;
+            jobs[i].released = true;
+            jobs[i].release = millis();
+            return i;
+        }
+    }
+
+    LOG_DEBUG_ERROR("Too many jobs!");
+    return -1;
+}
+
+
+void S8_scheduler::remove(int8_t job) {
+    if (job >= 0 && job < S8_SCHEDULER_MAX_JOBS) {
+        jobs[job].active = false;
+    }
+}
+
+
+uint8_t S8_scheduler::utilisation() {
+    uint32_t elapsed = millis() - start_ms;
+
+    return (elapsed > 0) ? (uint8_t)((uint64_t)busy_ms * 100 / elapsed) : 0;
+}
+
+
+void S8_scheduler::tick() {
+    uint32_t now = millis();
+
+    if (batch != 0) {
+        uint8_t status = sensor->poll_transaction();
+
+        if (status == S8_TRANSACTION_PENDING) {
+            return;
+        }
+        finish(now, status);
+    }
+
+    release(now);
+    start(now);
+}
+
+
+/* Order of jobs: priority, then rate monotonic (shorter period first, one-shot jobs first), then release time */
+bool S8_scheduler::before(const Job &a, const Job &b) {
+    if (a.priority != b.priority) {
+        return a.priority > b.priority;
+    }
+
+    if (a.period_ms != b.period_ms) {
+        return a.period_ms < b.period_ms;
+    }
+
+    return (int32_t)(a.release - b.release) < 0;
+}
+
+
+/* Release periodic jobs whose period has elapsed */
+void S8_scheduler::release(uint32_t now) {
+    for (uint8_t i = 0; i < S8_SCHEDULER_MAX_JOBS; i++) {
+        Job &job = jobs[i];
+
+        if (!job.active || job.period_ms == 0 || (batch & (1 << i))) {
+            continue;
+        }
+
+        while ((int32_t)(now - (job.release + job.period_ms)) >= 0) {
+            if (job.released) {
+                deadline_misses++;          // Previous release not done yet
+            }
+            job.release += job.period_ms;
+            job.released = true;
+        }
+    }
+}
+
+
+/* Start the most urgent released job, merging reads of the same type due now */
+void S8_scheduler::start(uint32_t now) {
+    int8_t first = -1;
+
+    for (uint8_t i = 0; i < S8_SCHEDULER_MAX_JOBS; i++) {
+        if (jobs[i].active && jobs[i].released && (first < 0 || before(jobs[i], jobs[first]))) {
+            first = i;
+        }
+    }
+
+    if (first < 0) {
+        return;
+    }
+
+    Job &job = jobs[first];
+    bool result;
+
+    batch = 1 << first;
+
+    if (job.func == MODBUS_FUNC_WRITE_SINGLE_REGISTER) {
+        batch_reg = job.reg;
+        result = sensor->request_write(job.reg, job.value);
+
+    } else {
+        uint16_t low = job.reg;
+        uint16_t high = job.reg + job.words;
+        bool merged;
+
+        // Only adjacent or overlapping ranges, a gap could contain reserved registers that the sensor does not
+        // answer (ex: IR23-IR25 between IR22 and IR26). Repeat until no change, a job can fill a gap between two.
+        do {
+            merged = false;
+
+            for (uint8_t i = 0; i < S8_SCHEDULER_MAX_JOBS; i++) {
+                Job &other = jobs[i];
+
+                if ((batch & (1 << i)) || !other.active || !other.released || other.func != job.func ||
+                    other.reg > high || other.reg + other.words < low) {
+                    continue;
+                }
+
+                uint16_t new_low = (other.reg < low) ? other.reg : low;
+                uint16_t new_high = (other.reg + other.words > high) ? other.reg + other.words : high;
+
+                if (new_high - new_low <= S8_SCHEDULER_MAX_WORDS) {
+                    low = new_low;
+                    high = new_high;
+                    batch |= 1 << i;
+                    merged = true;
+                }
+            }
+        } while (merged);
+
+        batch_reg = low;
+        result = sensor->request_read(job.func, low, high - low);
+    }
+
+    batch_start = now;
+
+    if (!result) {
+        finish(now, S8_TRANSACTION_ERROR);
+    }
+}
+
+
+/* Report jobs of the finished transaction */
+void S8_scheduler::finish(uint32_t now, uint8_t status) {
+    uint8_t done = batch;
+
+    batch = 0;
+    transactions++;
+    busy_ms += now - batch_start;
+
+    for (uint8_t i = 0; i < S8_SCHEDULER_MAX_JOBS; i++) {
+        if (!(done & (1 << i)) || !jobs[i].active) {
+            continue;
+        }
+
+        Job &job = jobs[i];
+        const uint8_t *data = sensor->response_data();
+
+        if (job.func != MODBUS_FUNC_WRITE_SINGLE_REGISTER) {
+            data += (job.reg - batch_reg) * 2;
+        }
+
+        jobs_done++;
+        if ((now - job.release) > job.deadline_ms) {
+            deadline_misses++;
+        }
+
+        job.released = false;
+        if (job.period_ms == 0) {
+            job.active = false;     // Only once
+        }
+
+        if (job.callback != NULL) {
+            job.callback(i, status, data);
+        }
+    }
+}
@@ -0,0 +1,108 @@
+/***************************************************************************************************************************
+
+	SenseAir S8 Transaction Scheduler
+
+	Copyright (c) 2021 Josep Comas
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+	SOFTWARE.
+
+***************************************************************************************************************************/
+
+
+#ifndef _S8_SCHEDULER_H
+    #define _S8_SCHEDULER_H
+
+    #include "s8_uart.h"
+
+
+    #define S8_SCHEDULER_MAX_JOBS   8       // Max jobs of a scheduler
+    #define S8_PRIORITY_COMMAND     255     // Priority of commands (before any periodic read)
+    #define S8_SCHEDULER_MAX_WORDS  ((S8_LEN_BUF_MSG - 5) / 2)    // Max words read in one transaction
+
+
+    /* Job finished (status = S8_TRANSACTION_xxx), data points to the words of the job (decode with REG::decode) */
+    typedef void (*S8_job_callback)(int8_t job, uint8_t status, const uint8_t *data);
+
+
+    /*
+        Queue of transactions with period, deadline and priority, called from loop() with tick()
+
+        Released jobs are started by priority (higher first, commands use S8_PRIORITY_COMMAND) and, with the
+        same priority, by rate monotonic order (shorter period first). Reads of the same type due at the same
+        time are merged in one transaction when their registers are adjacent (or overlap) and fit in one
+        response. A job finished after its deadline, or a release skipped because the previous one was still
+        waiting, is a deadline miss.
+    */
+    class S8_scheduler
+    {
+        public:
+            S8_scheduler(S8_UART &sensor);
+
+            /* Read job (period 0 = only once, deadline 0 = period), returns job number or -1 */
+            int8_t add_read(uint8_t func, uint16_t reg, uint8_t words, uint32_t period_ms, S8_job_callback callback,
+                            uint32_t deadline_ms = 0, uint8_t priority = 0);
+
+            template <class REG>
+            int8_t add_read(uint32_t period_ms, S8_job_callback callback, uint32_t deadline_ms = 0, uint8_t priority = 0) {
+                return add_read(REG::func, REG::addr, REG::words, period_ms, callback, deadline_ms, priority);
+            }
+
+            /* Write of a holding register (only once), returns job number or -1 */
+            int8_t add_write(uint16_t reg, uint16_t value, S8_job_callback callback, uint32_t deadline_ms = S8_TIMEOUT,
+                             uint8_t priority = S8_PRIORITY_COMMAND);
+
+            void remove(int8_t job);                                                // Remove a job
+            void tick();                                                            // Call it from loop()
+
+            uint32_t transactions;                                                  // Transactions done
+            uint32_t jobs_done;                                                     // Jobs finished (a transaction can finish several jobs)
+            uint32_t deadline_misses;                                               // Jobs finished late or skipped
+            uint32_t busy_ms;                                                       // Time with a transaction in the bus
+            uint8_t utilisation();                                                  // Bus utilisation (%) since start
+
+        private:
+            struct Job {
+                bool active;
+                uint8_t func;
+                uint16_t reg;
+                uint8_t words;
+                uint16_t value;                                                     // Value to write
+                uint8_t priority;
+                uint32_t period_ms;
+                uint32_t deadline_ms;
+                uint32_t release;                                                   // Time of current release
+                bool released;                                                      // Waiting to be done
+                S8_job_callback callback;
+            };
+
+            S8_UART *sensor;
+            Job jobs[S8_SCHEDULER_MAX_JOBS];
+            uint8_t batch;                                                          // Jobs of the transaction in the bus (bit mask)
+            uint16_t batch_reg;                                                     // First register of the transaction
+            uint32_t batch_start;
+            uint32_t start_ms;
+
+            int8_t add(Job &job);
+            bool before(const Job &a, const Job &b);
+            void release(uint32_t now);
+            void start(uint32_t now);
+            void finish(uint32_t now, uint8_t status);
+    };
+
+#endif
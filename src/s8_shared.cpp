@@ -0,0 +1,183 @@
+/***************************************************************************************************************************
+
+	SenseAir S8 Shared Access
+
+	Copyright (c) 2021 Josep Comas
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+	SOFTWARE.
+
+***************************************************************************************************************************/
+
+
+
+#include "s8_shared.h"
+#include "utils.h"
+
+
+#if defined(ARDUINO_ARCH_ESP32)
+
+S8_mutex::S8_mutex() { mutex = xSemaphoreCreateMutex(); }
+S8_mutex::~S8_mutex() { vSemaphoreDelete(mutex); }
+void S8_mutex::lock() { xSemaphoreTake(mutex, portMAX_DELAY); }
+void S8_mutex::unlock() { xSemaphoreGive(mutex); }
+
+#elif defined(ARDUINO_ARCH_RP2040)
+
+S8_mutex::S8_mutex() { mutex_init(&mutex); }
+S8_mutex::~S8_mutex() {}
+void S8_mutex::lock() { mutex_enter_blocking(&mutex); }
+void S8_mutex::unlock() { mutex_exit(&mutex); }
+
+#elif defined(S8_HOST)
+
+S8_mutex::S8_mutex() { pthread_mutex_init(&mutex, NULL); }
+S8_mutex::~S8_mutex() { pthread_mutex_destroy(&mutex); }
+void S8_mutex::lock() { pthread_mutex_lock(&mutex); }
+void S8_mutex::unlock() { pthread_mutex_unlock(&mutex); }
+
+#else
+
+S8_mutex::S8_mutex() {}
+S8_mutex::~S8_mutex() {}
+void S8_mutex::lock() {}
+void S8_mutex::unlock() {}
+
+#endif
+
+
+S8_shared::S8_shared(S8_UART &sensor) {
+    this->sensor = &sensor;
+    active = false;
+    generation = 0;
+    done_generation = 0;
+    done_func = 0;
+    done_reg = 0;
+    done_words = 0;
+    done_result = false;
+    requests = 0;
+    transactions = 0;
+    coalesced = 0;
+}
+
+
+/*
+    Read consecutive registers
+
+    Every transaction has a generation number. A read can use the response of a transaction of the same
+    registers that was in progress when it was asked or that started later, so it is never older than the
+    request. The task waits for the bus and, if such a response is there, it doesn't send a new request.
+*/
+bool S8_shared::read(uint8_t func, uint16_t reg, uint8_t words, uint8_t *data) {
+
+    if (words == 0 || words * 2 > (int)sizeof(done_data)) {
+        LOG_DEBUG_ERROR("Invalid request!");
+        return false;
+    }
+
+    state.lock();
+    requests++;
+    uint32_t oldest = active ? generation : generation + 1;      // Oldest transaction with a valid answer for this request
+    state.unlock();
+
+    bus.lock();
+
+    state.lock();
+    if (done_generation >= oldest && done_func == func && done_reg == reg && done_words == words) {
+        bool result = done_result;
+        memcpy(data, done_data, words * 2);
+        coalesced++;
+        state.unlock();
+        bus.unlock();
+        return result;
+    }
+
+    active = true;
+    uint32_t current = ++generation;
+    transactions++;
+    state.unlock();
+
+    bool result = sensor->request_read(func, reg, words) && sensor->wait_transaction() == S8_TRANSACTION_DONE;
+
+    state.lock();
+    if (result) {
+        memcpy(done_data, sensor->response_data(), words * 2);
+        memcpy(data, done_data, words * 2);
+    }
+    done_func = func;
+    done_reg = reg;
+    done_words = words;
+    done_result = result;
+    done_generation = current;
+    active = false;
+    state.unlock();
+
+    bus.unlock();
+
+    return result;
+}
+
+
+/* Write a holding register (never coalesced, every write is a command) */
+bool S8_shared::write(uint16_t reg, uint16_t value) {
+
+    bus.lock();
+
+    state.lock();
+    active = true;
+    generation++;
+    transactions++;
+    done_generation = 0;     // Reads before the write are not valid anymore
+    state.unlock();
+
+    bool result = sensor->request_write(reg, value) && sensor->wait_transaction() == S8_TRANSACTION_DONE;
+
+    state.lock();
+    active = false;
+    state.unlock();
+
+    bus.unlock();
+
+    return result;
+}
+
+
+/* Get CO2 value in ppm */
+int16_t S8_shared::get_co2() {
+
+    int16_t co2 = 0;
+
+    if (!read<S8_reg_co2>(co2)) {
+        LOG_DEBUG_ERROR("Error getting CO2 value!");
+    }
+
+    return co2;
+}
+
+
+/* Get meter status */
+int16_t S8_shared::get_meter_status() {
+
+    int16_t status = 0;
+
+    if (!read<S8_reg_meter_status>(status)) {
+        LOG_DEBUG_ERROR("Error getting meter status!");
+    }
+
+    return status;
+}
@@ -0,0 +1,113 @@
+/***************************************************************************************************************************
+
+	SenseAir S8 Shared Access
+
+	Copyright (c) 2021 Josep Comas
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+	SOFTWARE.
+
+***************************************************************************************************************************/
+
+
+
+#ifndef _S8_SHARED_H
+    #define _S8_SHARED_H
+
+    #include "s8_uart.h"
+
+    #if defined(ARDUINO_ARCH_ESP32)
+        #include "freertos/FreeRTOS.h"
+        #include "freertos/semphr.h"
+    #elif defined(ARDUINO_ARCH_RP2040)
+        #include "pico/mutex.h"
+    #elif defined(S8_HOST)
+        #include <pthread.h>
+    #endif
+
+
+    /* Mutex of the platform (FreeRTOS, pico-sdk, pthread, nothing on single thread boards) */
+    class S8_mutex
+    {
+        public:
+            S8_mutex();
+            ~S8_mutex();
+
+            void lock();
+            void unlock();
+
+        private:
+        #if defined(ARDUINO_ARCH_ESP32)
+            SemaphoreHandle_t mutex;
+        #elif defined(ARDUINO_ARCH_RP2040)
+            mutex_t mutex;
+        #elif defined(S8_HOST)
+            pthread_mutex_t mutex;
+        #endif
+    };
+
+
+    /*
+        S8_UART shared by several tasks or threads
+
+        Transactions of the bus are serialised with a mutex held only during the transaction. If a task asks for
+        the same registers that another task is reading (or will read before this task gets the bus), it does not
+        send a new request: it gets a copy of that response. All access to the sensor must go through here.
+    */
+    class S8_shared
+    {
+        public:
+            S8_shared(S8_UART &sensor);
+
+            bool read(uint8_t func, uint16_t reg, uint8_t words, uint8_t *data);    // Read consecutive registers (data: words * 2 bytes)
+            bool write(uint16_t reg, uint16_t value);                               // Write a holding register
+
+            template <class REG>
+            bool read(typename REG::value_type &value) {
+                uint8_t data[REG::words * 2];
+                if (!read(REG::func, REG::addr, REG::words, data)) {
+                    return false;
+                }
+                value = REG::decode(data);
+                return true;
+            }
+
+            int16_t get_co2();                                                      // Get CO2 value in ppm (0 if error)
+            int16_t get_meter_status();                                             // Get meter status (0 if error)
+
+            uint32_t requests;                                                      // Reads asked by tasks
+            uint32_t transactions;                                                  // Transactions sent to the bus
+            uint32_t coalesced;                                                     // Reads answered with the transaction of another task
+
+        private:
+            S8_UART* sensor;
+            S8_mutex bus;                                                           // Held during a transaction
+            S8_mutex state;                                                         // Held only to check or update the current read
+
+            // Transaction in progress and last read, shared with waiting tasks
+            bool active;
+            uint32_t generation;                                                    // Number of last transaction
+            uint32_t done_generation;                                               // Number of last read (0 = none)
+            uint8_t done_func;
+            uint16_t done_reg;
+            uint8_t done_words;
+            bool done_result;
+            uint8_t done_data[S8_LEN_BUF_MSG - 5];
+    };
+
+#endif
@@ -0,0 +1,171 @@
+/***************************************************************************************************************************
+
+	SenseAir S8 Telemetry Encoder
+
+	Copyright (c) 2021 Josep Comas
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+	SOFTWARE.
+
+***************************************************************************************************************************/
+
+
+
+#include "s8_telemetry.h"
+
+
+S8_telemetry::S8_telemetry(char *buf, size_t size, uint8_t format) {
+    this->buf = buf;
+    this->size = size;
+    this->format = format;
+    len = 0;
+    count = 0;
+    measurement = "s8";
+    flush_size = size;
+    max_age_ms = 60000;
+    first_time = 0;
+    callback = NULL;
+    batches = 0;
+    dropped = 0;
+}
+
+
+/* Flush when the batch reaches flush_size bytes or its first sample is max_age_ms old */
+void S8_telemetry::set_flush(size_t flush_size, uint32_t max_age_ms) {
+    this->flush_size = flush_size;
+    this->max_age_ms = max_age_ms;
+}
+
+
+/* Escape of line protocol: backslash before special characters, a newline would end the line so it is removed */
+static void put_line_escaped(S8_writer &out, const char *str, const char *special) {
+    for (; *str != '\0'; str++) {
+        if (*str == '\n' || *str == '\r') {
+            continue;
+        }
+        if (strchr(special, *str) != NULL) {
+            out.put('\\');
+        }
+        out.put(*str);
+    }
+}
+
+
+/* Encode one sample, returns its length (0 if it does not fit in a record) */
+size_t S8_telemetry::encode(char *record, const char *name, const S8_sensor &sensor, uint64_t timestamp) {
+
+    S8_writer out(record, S8_TELEMETRY_LEN_RECORD);
+
+    if (format == S8_TELEMETRY_JSON) {
+        // {"sensor":"office","co2":400,"meter_status":0,"alarm_status":0,"output_status":0,"time":1700000000000}
+        out.put("{\"sensor\":\""); out.put_escaped(name);
+        out.put("\",\"co2\":"); out.put_int(sensor.co2);
+        out.put(",\"meter_status\":"); out.put_int(sensor.meter_status);
+        out.put(",\"alarm_status\":"); out.put_int(sensor.alarm_status);
+        out.put(",\"output_status\":"); out.put_int(sensor.output_status);
+        if (timestamp != 0) {
+            out.put(",\"time\":"); out.put_uint64(timestamp);
+        }
+        out.put('}');
+
+    } else {
+        // s8,sensor=office co2=400i,meter_status=0i,alarm_status=0i,output_status=0i 1700000000000
+        put_line_escaped(out, measurement, ", ");
+        out.put(",sensor=");
+        put_line_escaped(out, name, ",= \\");
+        out.put(" co2="); out.put_int(sensor.co2);
+        out.put("i,meter_status="); out.put_int(sensor.meter_status);
+        out.put("i,alarm_status="); out.put_int(sensor.alarm_status);
+        out.put("i,output_status="); out.put_int(sensor.output_status);
+        out.put('i');
+        if (timestamp != 0) {
+            out.put(' '); out.put_uint64(timestamp);
+        }
+        out.put('\n');
+    }
+
+    return out.overflow() ? 0 : out.length();
+}
+
+
+/* Add a sample to the batch */
+bool S8_telemetry::add(const char *name, const S8_sensor &sensor, uint64_t timestamp) {
+
+    char record[S8_TELEMETRY_LEN_RECORD];
+    size_t n = encode(record, name, sensor, timestamp);
+    size_t extra = (format == S8_TELEMETRY_JSON) ? 2 : 0;      // Separator and end of array
+
+    if (n == 0 || n + extra + 1 > size) {
+        dropped++;
+        return false;
+    }
+
+    if (len + n + extra + 1 > size || count == 0xFFFF) {
+        flush();        // No space or counter full
+    }
+
+    if (count == 0) {
+        first_time = millis();
+        if (format == S8_TELEMETRY_JSON) {
+            buf[len++] = '[';
+        }
+    } else if (format == S8_TELEMETRY_JSON) {
+        buf[len++] = ',';
+    }
+
+    memcpy(&buf[len], record, n);
+    len += n;
+    count++;
+
+    if (len >= flush_size) {
+        flush();
+    }
+
+    return true;
+}
+
+
+/* Flush on age */
+void S8_telemetry::tick() {
+
+    if (count > 0 && (millis() - first_time) >= max_age_ms) {
+        flush();
+    }
+}
+
+
+/* Send batch */
+void S8_telemetry::flush() {
+
+    if (count == 0) {
+        return;
+    }
+
+    if (format == S8_TELEMETRY_JSON) {
+        buf[len++] = ']';
+    }
+    buf[len] = '\0';
+
+    if (callback != NULL) {
+        callback(buf, len);
+    }
+
+    batches++;
+    len = 0;
+    count = 0;
+}
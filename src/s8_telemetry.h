@@ -0,0 +1,84 @@
+/***************************************************************************************************************************
+
+	SenseAir S8 Telemetry Encoder
+
+	Copyright (c) 2021 Josep Comas
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+	SOFTWARE.
+
+***************************************************************************************************************************/
+
+
+
+#ifndef _S8_TELEMETRY_H
+    #define _S8_TELEMETRY_H
+
+    #include "s8_uart.h"
+    #include "s8_writer.h"
+
+
+    #define S8_TELEMETRY_LINE_PROTOCOL  0       // InfluxDB line protocol, one line per sample
+    #define S8_TELEMETRY_JSON           1       // Compact JSON array, one object per sample
+
+    #define S8_TELEMETRY_LEN_RECORD   160       // Max length of one encoded sample
+
+
+    typedef void (*S8_telemetry_callback)(const char *payload, size_t len);        // Batch to send
+
+
+    /*
+        Batches of samples for uplink
+
+        Samples of one or many sensors are encoded (integers only, no printf) one after the other in a buffer given
+        by the caller. The batch is given to the callback when the buffer cannot hold the next sample, when it
+        reaches flush_size bytes or when its first sample is older than max_age_ms (checked in tick()).
+    */
+    class S8_telemetry
+    {
+        public:
+            S8_telemetry(char *buf, size_t size, uint8_t format = S8_TELEMETRY_LINE_PROTOCOL);
+
+            void set_measurement(const char *name) { measurement = name; }         // Measurement of line protocol (default "s8")
+            void set_flush(size_t flush_size, uint32_t max_age_ms);                 // Flush conditions (default: buffer full, 60 seconds)
+            void on_batch(S8_telemetry_callback callback) { this->callback = callback; }
+
+            bool add(const char *name, const S8_sensor &sensor, uint64_t timestamp = 0);   // Add sample (timestamp 0 = time of the receiver)
+            void tick();                                                            // Call it from loop() (flush on age)
+            void flush();                                                           // Send batch now
+
+            uint16_t samples() { return count; }                                   // Samples in the batch
+            uint32_t batches;                                                       // Batches sent
+            uint32_t dropped;                                                       // Samples bigger than the buffer
+
+        private:
+            char* buf;
+            size_t size;
+            size_t len;
+            uint8_t format;
+            uint16_t count;
+            const char *measurement;
+            size_t flush_size;
+            uint32_t max_age_ms;
+            uint32_t first_time;
+            S8_telemetry_callback callback;
+
+            size_t encode(char *record, const char *name, const S8_sensor &sensor, uint64_t timestamp);
+    };
+
+#endif
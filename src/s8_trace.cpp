@@ -0,0 +1,299 @@
+/***************************************************************************************************************************
+
+	SenseAir S8 Traffic Capture and Replay
+
+	Copyright (c) 2021 Josep Comas
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+	SOFTWARE.
+
+***************************************************************************************************************************/
+
+
+
+#include "s8_trace.h"
+
+
+static const uint8_t trace_header[S8_TRACE_LEN_HEADER] = { 'S', '8', 'T', 'R', S8_TRACE_VERSION };
+
+
+S8_capture_transport::S8_capture_transport(S8_transport &transport) {
+    this->transport = &transport;
+    buf = NULL;
+    size = 0;
+    len = 0;
+    writer = NULL;
+    capturing = false;
+    last_us = 0;
+    lost = 0;
+}
+
+
+/* Record in memory */
+void S8_capture_transport::capture_to(uint8_t *buf, size_t size) {
+    this->buf = buf;
+    this->size = size;
+    writer = NULL;
+}
+
+
+/* Record with a function */
+void S8_capture_transport::capture_to(S8_trace_writer writer) {
+    this->writer = writer;
+    buf = NULL;
+    size = 0;
+}
+
+
+/* Start a new trace */
+void S8_capture_transport::start() {
+    len = 0;
+    lost = 0;
+    last_us = micros();
+    capturing = true;
+    emit(trace_header, S8_TRACE_LEN_HEADER);
+}
+
+
+uint8_t S8_capture_transport::write(const uint8_t *buf, uint8_t size) {
+    record(S8_TRACE_TX, buf, size);
+    return transport->write(buf, size);
+}
+
+
+uint8_t S8_capture_transport::read(uint8_t *buf, uint8_t max_bytes) {
+    uint8_t n = transport->read(buf, max_bytes);
+    if (n > 0) {
+        record(0, buf, n);
+    }
+    return n;
+}
+
+
+/* Add record (split in records of S8_TRACE_MAX_DATA bytes) */
+void S8_capture_transport::record(uint8_t direction, const uint8_t *data, uint8_t n) {
+
+    uint8_t rec[1 + 5 + S8_TRACE_MAX_DATA];
+
+    if (!capturing) {
+        return;
+    }
+
+    uint32_t now = micros();
+    uint32_t delta = now - last_us;
+    last_us = now;
+
+    while (n > 0) {
+        uint8_t chunk = (n > S8_TRACE_MAX_DATA) ? S8_TRACE_MAX_DATA : n;
+        uint8_t pos = 0;
+
+        rec[pos++] = direction | chunk;
+        do {
+            rec[pos++] = (delta & 0x7F) | ((delta > 0x7F) ? 0x80 : 0x00);
+            delta >>= 7;
+        } while (delta > 0);
+        memcpy(&rec[pos], data, chunk);
+        emit(rec, pos + chunk);
+
+        data += chunk;
+        n -= chunk;
+        delta = 0;
+    }
+}
+
+
+/* Write bytes of the trace (a record is never written partially) */
+void S8_capture_transport::emit(const uint8_t *data, size_t n) {
+
+    if (writer != NULL) {
+        writer(data, n);
+
+    } else if (buf != NULL && len + n <= size) {
+        memcpy(&buf[len], data, n);
+        len += n;
+
+    } else {
+        lost++;
+    }
+}
+
+
+S8_trace_reader::S8_trace_reader(const uint8_t *trace, size_t size) {
+    this->trace = trace;
+    this->size = size;
+    ok = (size >= S8_TRACE_LEN_HEADER && memcmp(trace, trace_header, S8_TRACE_LEN_HEADER) == 0);
+    rewind();
+}
+
+
+void S8_trace_reader::rewind() {
+    pos = S8_TRACE_LEN_HEADER;
+    time_us = 0;
+}
+
+
+/* Next record */
+bool S8_trace_reader::next(S8_trace_record &record) {
+
+    if (!ok || pos >= size) {
+        return false;
+    }
+
+    uint8_t head = trace[pos++];
+    uint32_t delta = 0;
+    uint8_t shift = 0;
+
+    do {
+        if (pos >= size || shift > 28) {
+            ok = false;
+            return false;
+        }
+        delta |= (uint32_t)(trace[pos] & 0x7F) << shift;
+        shift += 7;
+    } while (trace[pos++] & 0x80);
+
+    record.tx = (head & S8_TRACE_TX) != 0;
+    record.len = head & S8_TRACE_MAX_DATA;
+    if (pos + record.len > size) {
+        ok = false;
+        return false;
+    }
+
+    time_us += delta;
+    record.time_us = time_us;
+    record.data = &trace[pos];
+    pos += record.len;
+
+    return true;
+}
+
+
+S8_replay_transport::S8_replay_transport(const uint8_t *trace, size_t size, bool timing) : reader(trace, size) {
+    this->timing = timing;
+    request_len = 0;
+    request_us = 0;
+    sent_us = 0;
+    sent = false;
+    have_pending = false;
+    rx_pos = 0;
+    mismatches = 0;
+}
+
+
+/* Move to the next request of the trace */
+bool S8_replay_transport::next_request(uint8_t *request, uint8_t &len) {
+
+    // Skip received bytes not read by the previous transaction
+    while (have_pending || reader.next(pending)) {
+        have_pending = false;
+
+        if (pending.tx) {
+            memcpy(this->request, pending.data, pending.len);
+            request_len = pending.len;
+            request_us = pending.time_us;
+            memcpy(request, pending.data, pending.len);
+            len = pending.len;
+
+            sent = false;
+            rx_pos = 0;
+            have_pending = reader.next(pending);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+/* Request sent by S8_UART, received bytes of the trace start to arrive */
+uint8_t S8_replay_transport::write(const uint8_t *buf, uint8_t size) {
+
+    if (size != request_len || memcmp(buf, request, size) != 0) {
+        mismatches++;
+    }
+
+    sent_us = micros();
+    sent = true;
+    return size;
+}
+
+
+/* Pending record has received bytes ready to read */
+bool S8_replay_transport::rx_due() {
+
+    if (!sent || !have_pending || pending.tx) {
+        return false;
+    }
+
+    return !timing || (micros() - sent_us) >= (pending.time_us - request_us);
+}
+
+
+int S8_replay_transport::available() {
+    return rx_due() ? pending.len - rx_pos : 0;
+}
+
+
+uint8_t S8_replay_transport::read(uint8_t *buf, uint8_t max_bytes) {
+
+    uint8_t nb = 0;
+
+    while (nb < max_bytes && rx_due()) {
+        uint8_t n = pending.len - rx_pos;
+        if (n > max_bytes - nb) {
+            n = max_bytes - nb;
+        }
+
+        memcpy(&buf[nb], &pending.data[rx_pos], n);
+        nb += n;
+        rx_pos += n;
+
+        if (rx_pos == pending.len) {
+            rx_pos = 0;
+            have_pending = reader.next(pending);
+        }
+    }
+
+    return nb;
+}
+
+
+/* Sleep until received bytes are due or timeout */
+bool S8_replay_transport::wait(uint32_t timeout_ms) {
+
+    if (rx_due()) {
+        return true;
+    }
+
+    if (!sent || !have_pending || pending.tx) {
+        delay(timeout_ms);      // Nothing more was received in the trace
+        return false;
+    }
+
+    uint32_t due_us = pending.time_us - request_us;
+    uint32_t elapsed_us = micros() - sent_us;
+    uint32_t wait_ms = (due_us - elapsed_us + 999) / 1000;
+
+    if (wait_ms > timeout_ms) {
+        delay(timeout_ms);
+        return false;
+    }
+
+    delay(wait_ms);
+    return rx_due();
+}
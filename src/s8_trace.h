@@ -0,0 +1,153 @@
+/***************************************************************************************************************************
+
+	SenseAir S8 Traffic Capture and Replay
+
+	Copyright (c) 2021 Josep Comas
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+	SOFTWARE.
+
+***************************************************************************************************************************/
+
+
+
+#ifndef _S8_TRACE_H
+    #define _S8_TRACE_H
+
+    #include "s8_transport.h"
+
+
+    /*
+        Binary trace of the traffic with the sensor
+
+        Header: "S8TR" + version (1 byte). Then one record per write or read of the transport:
+          - 1 byte: direction (bit 7, 1 = TX) + number of bytes (bits 0-6, max 127)
+          - time since previous record in microseconds (unsigned LEB128 varint, 1-5 bytes)
+          - bytes
+    */
+    #define S8_TRACE_VERSION        1
+    #define S8_TRACE_LEN_HEADER     5
+    #define S8_TRACE_TX             0x80
+    #define S8_TRACE_MAX_DATA       127
+
+
+    typedef void (*S8_trace_writer)(const uint8_t *data, size_t len);              // Write trace bytes (file, SD card, serial port)
+
+
+    /* Transport that records the traffic of another transport */
+    class S8_capture_transport : public S8_transport
+    {
+        public:
+            S8_capture_transport(S8_transport &transport);
+
+            void capture_to(uint8_t *buf, size_t size);                             // Record in memory
+            void capture_to(S8_trace_writer writer);                                // Record with a function
+            void start();                                                           // Start a new trace (writes header)
+            void stop() { capturing = false; }
+
+            size_t length() { return len; }                                         // Bytes of the trace in memory
+            uint32_t lost;                                                          // Records lost (memory full)
+
+            uint8_t write(const uint8_t *buf, uint8_t size) override;
+            void flush() override { transport->flush(); }
+            int available() override { return transport->available(); }
+            uint8_t read(uint8_t *buf, uint8_t max_bytes) override;
+            bool wait(uint32_t timeout_ms) override { return transport->wait(timeout_ms); }
+            bool tx_done() override { return transport->tx_done(); }
+            bool failed() override { return transport->failed(); }
+
+        private:
+            S8_transport* transport;
+            uint8_t* buf;
+            size_t size;
+            size_t len;
+            S8_trace_writer writer;
+            bool capturing;
+            uint32_t last_us;
+
+            void record(uint8_t direction, const uint8_t *data, uint8_t n);
+            void emit(const uint8_t *data, size_t n);
+    };
+
+
+    /* Record of a trace */
+    struct S8_trace_record {
+        bool tx;                            // Sent to the sensor (false = received)
+        uint32_t time_us;                   // Time since start of the trace
+        uint8_t len;
+        const uint8_t *data;
+    };
+
+
+    /* Read records of a trace in memory */
+    class S8_trace_reader
+    {
+        public:
+            S8_trace_reader(const uint8_t *trace, size_t size);
+
+            bool valid() { return ok; }                                             // Header is right
+            bool next(S8_trace_record &record);                                     // Next record (false at the end or if it is corrupted)
+            void rewind();
+
+        private:
+            const uint8_t* trace;
+            size_t size;
+            size_t pos;
+            uint32_t time_us;
+            bool ok;
+    };
+
+
+    /*
+        Transport that answers with the bytes received in a trace
+
+        next_request() moves to the next request of the trace. When S8_UART sends it, the bytes received after
+        it in the trace become available with the original timing (or at once if timing is false).
+    */
+    class S8_replay_transport : public S8_transport
+    {
+        public:
+            S8_replay_transport(const uint8_t *trace, size_t size, bool timing = true);
+
+            bool next_request(uint8_t *request, uint8_t &len);                     // Next request of the trace (false at the end)
+            uint32_t request_time_us() { return request_us; }                      // Time of the request in the trace
+            uint32_t mismatches;                                                    // Bytes sent that differ from the trace
+
+            uint8_t write(const uint8_t *buf, uint8_t size) override;
+            void flush() override {}
+            int available() override;
+            uint8_t read(uint8_t *buf, uint8_t max_bytes) override;
+            bool wait(uint32_t timeout_ms) override;
+
+        private:
+            S8_trace_reader reader;
+            bool timing;
+            uint8_t request[S8_TRACE_MAX_DATA];
+            uint8_t request_len;
+            uint32_t request_us;                                                    // Time of request in the trace
+            uint32_t sent_us;                                                       // Time when request was sent (micros)
+            bool sent;
+
+            S8_trace_record pending;                                                // Next record not used yet
+            bool have_pending;
+            uint8_t rx_pos;                                                         // Bytes already read of pending record (received bytes)
+
+            bool rx_due();                                                          // Pending record has received bytes ready to read
+    };
+
+#endif
@@ -0,0 +1,301 @@
+/***************************************************************************************************************************
+
+	SenseAir S8 Transport Layer
+
+	Copyright (c) 2021 Josep Comas
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+	SOFTWARE.
+
+***************************************************************************************************************************/
+
+
+#include "s8_transport.h"
+#include "s8_uart.h"
+
+
+/* Wait for received bytes, default implementation is polling */
+bool S8_transport::wait(uint32_t timeout_ms) {
+    uint32_t start_t = millis();
+
+    while (available() <= 0) {
+        if ((millis() - start_t) > timeout_ms) {
+            return false;
+        }
+        yield();
+    }
+
+    return true;
+}
+
+
+#ifndef S8_HOST
+
+/* Stream backend */
+
+uint8_t S8_stream_transport::write(const uint8_t *buf, uint8_t size) {
+    return serial->write(buf, size);
+}
+
+
+void S8_stream_transport::flush() {
+    serial->flush();
+}
+
+
+int S8_stream_transport::available() {
+    return serial->available();
+}
+
+
+uint8_t S8_stream_transport::read(uint8_t *buf, uint8_t max_bytes) {
+    uint8_t nb = 0;
+
+    while (nb < max_bytes && serial->available() > 0) {
+        buf[nb++] = serial->read();
+    }
+
+    return nb;
+}
+
+#endif
+
+
+#ifdef ARDUINO_ARCH_ESP32
+
+/* ESP32 backend */
+
+S8_esp32_transport::S8_esp32_transport(uart_port_t port, int rx_pin, int tx_pin) {
+    this->port = port;
+    this->rx_pin = rx_pin;
+    this->tx_pin = tx_pin;
+    events = NULL;
+}
+
+
+bool S8_esp32_transport::begin() {
+    uart_config_t config = {};
+    config.baud_rate = S8_BAUDRATE;
+    config.data_bits = UART_DATA_8_BITS;
+    config.parity = UART_PARITY_DISABLE;
+    config.stop_bits = UART_STOP_BITS_1;
+    config.flow_ctrl = UART_HW_FLOWCTRL_DISABLE;
+
+    if (uart_param_config(port, &config) != ESP_OK ||
+        uart_set_pin(port, tx_pin, rx_pin, UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE) != ESP_OK ||
+        uart_driver_install(port, 256, 0, 8, &events, 0) != ESP_OK) {
+        LOG_DEBUG_ERROR("Error installing UART driver!");
+        return false;
+    }
+
+    return true;
+}
+
+
+void S8_esp32_transport::end() {
+    uart_driver_delete(port);
+    events = NULL;
+}
+
+
+uint8_t S8_esp32_transport::write(const uint8_t *buf, uint8_t size) {
+    int nb = uart_write_bytes(port, (const char *)buf, size);
+    return nb > 0 ? nb : 0;
+}
+
+
+void S8_esp32_transport::flush() {
+    uart_wait_tx_done(port, portMAX_DELAY);
+}
+
+
+bool S8_esp32_transport::tx_done() {
+    return uart_wait_tx_done(port, 0) == ESP_OK;
+}
+
+
+int S8_esp32_transport::available() {
+    size_t len = 0;
+    uart_get_buffered_data_len(port, &len);
+    return len;
+}
+
+
+uint8_t S8_esp32_transport::read(uint8_t *buf, uint8_t max_bytes) {
+    int nb = uart_read_bytes(port, buf, max_bytes, 0);
+    return nb > 0 ? nb : 0;
+}
+
+
+/* Block on the event queue of the driver until data is received */
+bool S8_esp32_transport::wait(uint32_t timeout_ms) {
+    uint32_t start_t = millis();
+    uart_event_t event;
+
+    while (available() <= 0) {
+        uint32_t elapsed = millis() - start_t;
+        if (elapsed > timeout_ms) {
+            return false;
+        }
+
+        if (xQueueReceive(events, &event, pdMS_TO_TICKS(timeout_ms - elapsed) + 1) == pdTRUE) {
+            if (event.type == UART_FIFO_OVF || event.type == UART_BUFFER_FULL) {
+                LOG_DEBUG_ERROR("UART overflow!");
+                uart_flush_input(port);
+                xQueueReset(events);
+            }
+        }
+    }
+
+    return true;
+}
+
+#endif
+
+
+#ifdef ARDUINO_ARCH_RP2040
+
+#include "hardware/irq.h"
+#include "hardware/gpio.h"
+#include "hardware/sync.h"
+#include "pico/time.h"
+
+/* RP2040 backend */
+
+static S8_rp2040_transport *rp2040_transports[2] = { NULL, NULL };
+
+static void rp2040_uart0_irq() {
+    if (rp2040_transports[0] != NULL) {
+        rp2040_transports[0]->on_irq();
+    }
+}
+
+static void rp2040_uart1_irq() {
+    if (rp2040_transports[1] != NULL) {
+        rp2040_transports[1]->on_irq();
+    }
+}
+
+
+S8_rp2040_transport::S8_rp2040_transport(uart_inst_t *uart, uint rx_pin, uint tx_pin) {
+    this->uart = uart;
+    this->rx_pin = rx_pin;
+    this->tx_pin = tx_pin;
+    rx_head = 0;
+    rx_tail = 0;
+}
+
+
+bool S8_rp2040_transport::begin() {
+    uint index = uart_get_index(uart);
+    uint irq = (index == 0) ? UART0_IRQ : UART1_IRQ;
+
+    uart_init(uart, S8_BAUDRATE);
+    uart_set_format(uart, 8, 1, UART_PARITY_NONE);
+    uart_set_fifo_enabled(uart, true);
+    gpio_set_function(tx_pin, GPIO_FUNC_UART);
+    gpio_set_function(rx_pin, GPIO_FUNC_UART);
+
+    rp2040_transports[index] = this;
+    irq_set_exclusive_handler(irq, (index == 0) ? rp2040_uart0_irq : rp2040_uart1_irq);
+    irq_set_enabled(irq, true);
+    uart_set_irq_enables(uart, true, false);
+
+    return true;
+}
+
+
+void S8_rp2040_transport::end() {
+    uint index = uart_get_index(uart);
+
+    uart_set_irq_enables(uart, false, false);
+    irq_set_enabled((index == 0) ? UART0_IRQ : UART1_IRQ, false);
+    rp2040_transports[index] = NULL;
+    uart_deinit(uart);
+}
+
+
+/* Called from interrupt (on the core that called begin) */
+void S8_rp2040_transport::on_irq() {
+    while (uart_is_readable(uart)) {
+        uint8_t c = uart_getc(uart);
+        uint8_t next = (rx_head + 1) & (S8_RP2040_RX_BUF - 1);
+
+        if (next != rx_tail) {          // Drop byte if buffer is full
+            rx_buf[rx_head] = c;
+            rx_head = next;
+        }
+    }
+
+    __sev();                            // Wake wait() on both cores
+}
+
+
+uint8_t S8_rp2040_transport::write(const uint8_t *buf, uint8_t size) {
+    uart_write_blocking(uart, buf, size);
+    return size;
+}
+
+
+/* Sleep (WFE) until the last stop bit is sent instead of spinning in uart_tx_wait_blocking, the alarm wakes
+   the core to check tx_done() */
+void S8_rp2040_transport::flush() {
+    while (!tx_done()) {
+        best_effort_wfe_or_timeout(make_timeout_time_us(S8_RP2040_TX_POLL_US));
+    }
+}
+
+
+/* TX FIFO empty and last stop bit sent */
+bool S8_rp2040_transport::tx_done() {
+    return (uart_get_hw(uart)->fr & UART_UARTFR_BUSY_BITS) == 0;
+}
+
+
+int S8_rp2040_transport::available() {
+    return (rx_head - rx_tail) & (S8_RP2040_RX_BUF - 1);
+}
+
+
+uint8_t S8_rp2040_transport::read(uint8_t *buf, uint8_t max_bytes) {
+    uint8_t nb = 0;
+
+    while (nb < max_bytes && rx_tail != rx_head) {
+        buf[nb++] = rx_buf[rx_tail];
+        rx_tail = (rx_tail + 1) & (S8_RP2040_RX_BUF - 1);
+    }
+
+    return nb;
+}
+
+
+/* Sleep (WFE) until the RX interrupt sends an event or the timeout alarm fires, there is no periodic tick
+   to wake a bare WFI and the interrupt can be served by the other core */
+bool S8_rp2040_transport::wait(uint32_t timeout_ms) {
+    absolute_time_t deadline = make_timeout_time_ms(timeout_ms);
+
+    while (rx_tail == rx_head) {
+        if (best_effort_wfe_or_timeout(deadline)) {
+            return rx_tail != rx_head;
+        }
+    }
+
+    return true;
+}
+
+#endif
@@ -0,0 +1,153 @@
+/***************************************************************************************************************************
+
+	SenseAir S8 Transport Layer
+
+	Copyright (c) 2021 Josep Comas
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+	SOFTWARE.
+
+***************************************************************************************************************************/
+
+
+#ifndef _S8_TRANSPORT_H
+    #define _S8_TRANSPORT_H
+
+    #include "utils.h"
+
+
+    /*
+        Byte transport used by S8_UART
+
+        write() queues the bytes of a request, flush() waits until they are sent and tx_done() tells it without
+        blocking. read() never blocks, it only returns bytes already received. wait() blocks until at least one
+        byte is received or timeout, event driven backends sleep there instead of spinning. failed() tells that
+        wait() returned because the port is gone (ex: USB adapter unplugged), a transaction ends at once then.
+    */
+    class S8_transport
+    {
+        public:
+            virtual ~S8_transport() {}
+
+            virtual uint8_t write(const uint8_t *buf, uint8_t size) = 0;           // Queue bytes to send (returns bytes queued)
+            virtual void flush() = 0;                                               // Wait until bytes are sent
+            virtual int available() = 0;                                            // Number of received bytes ready to read
+            virtual uint8_t read(uint8_t *buf, uint8_t max_bytes) = 0;             // Read received bytes (non-blocking)
+            virtual bool wait(uint32_t timeout_ms);                                 // Wait for received bytes (true if available)
+            virtual bool tx_done() { return true; }                                 // Bytes sent (true if unknown)
+            virtual bool failed() { return false; }                                 // Port hung up or failed, waiting is useless
+    };
+
+
+    #ifndef S8_HOST
+
+    /* Polling backend for any Arduino Stream (portable fallback) */
+    class S8_stream_transport : public S8_transport
+    {
+        public:
+            S8_stream_transport(Stream *serial) : serial(serial) {}
+
+            uint8_t write(const uint8_t *buf, uint8_t size) override;
+            void flush() override;
+            int available() override;
+            uint8_t read(uint8_t *buf, uint8_t max_bytes) override;
+
+        private:
+            Stream* serial;
+    };
+
+    #endif
+
+
+    #ifdef ARDUINO_ARCH_ESP32
+
+    #include "driver/uart.h"
+    #include "freertos/FreeRTOS.h"
+    #include "freertos/queue.h"
+
+    /*
+        ESP32 backend using the UART driver event queue, the task sleeps until the driver notifies received data.
+        The UART port must not be used by HardwareSerial at the same time.
+    */
+    class S8_esp32_transport : public S8_transport
+    {
+        public:
+            S8_esp32_transport(uart_port_t port, int rx_pin, int tx_pin);
+
+            bool begin();                                                           // Install UART driver (9600 8N1)
+            void end();                                                             // Uninstall UART driver
+
+            uint8_t write(const uint8_t *buf, uint8_t size) override;
+            void flush() override;
+            int available() override;
+            uint8_t read(uint8_t *buf, uint8_t max_bytes) override;
+            bool wait(uint32_t timeout_ms) override;
+            bool tx_done() override;
+
+        private:
+            uart_port_t port;
+            int rx_pin;
+            int tx_pin;
+            QueueHandle_t events;
+    };
+
+    #endif
+
+
+    #ifdef ARDUINO_ARCH_RP2040
+
+    #include "hardware/uart.h"
+
+    #define S8_RP2040_RX_BUF      32      // Size of receive ring buffer (power of 2)
+    #define S8_RP2040_TX_POLL_US  200     // Sleep between checks of the end of transmission (no TX interrupt)
+
+    /*
+        RP2040 backend filling a ring buffer from the UART RX interrupt, the core sleeps (WFE) while waiting a
+        response and while flush() waits the end of a request. The interrupt is enabled on the core that calls
+        begin() and it signals an event to both cores, so wait() can be called from the other core (ex: S8_runner
+        on core 1). The UART must not be used by another serial class at the same time.
+    */
+    class S8_rp2040_transport : public S8_transport
+    {
+        public:
+            S8_rp2040_transport(uart_inst_t *uart, uint rx_pin, uint tx_pin);
+
+            bool begin();                                                           // Setup UART (9600 8N1) and RX interrupt
+            void end();                                                             // Disable UART and RX interrupt
+
+            uint8_t write(const uint8_t *buf, uint8_t size) override;
+            void flush() override;
+            int available() override;
+            uint8_t read(uint8_t *buf, uint8_t max_bytes) override;
+            bool wait(uint32_t timeout_ms) override;
+            bool tx_done() override;
+
+            void on_irq();                                                          // Move bytes from RX FIFO to ring buffer
+
+        private:
+            uart_inst_t *uart;
+            uint rx_pin;
+            uint tx_pin;
+            uint8_t rx_buf[S8_RP2040_RX_BUF];
+            volatile uint8_t rx_head;                                               // Written by interrupt
+            volatile uint8_t rx_tail;                                               // Written by reader
+    };
+
+    #endif
+
+#endif
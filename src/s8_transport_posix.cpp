@@ -0,0 +1,214 @@
+/***************************************************************************************************************************
+
+	POSIX Serial Transport (Linux, ...)
+
+	Copyright (c) 2021 Josep Comas
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+	SOFTWARE.
+
+***************************************************************************************************************************/
+
+
+#include "s8_transport_posix.h"
+#include "s8_uart.h"
+
+#ifdef S8_HAS_POSIX_TRANSPORT
+
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/ioctl.h>
+
+
+S8_posix_transport::S8_posix_transport(const char *device) {
+    this->device = device;
+    port_fd = -1;
+    owner = false;
+    write_timeout = S8_TIMEOUT;
+    hung_up = false;
+    port_error = false;
+}
+
+
+S8_posix_transport::S8_posix_transport(int fd) {
+    device = NULL;
+    port_fd = fd;
+    owner = false;
+    write_timeout = S8_TIMEOUT;
+    hung_up = false;
+    port_error = false;
+}
+
+
+S8_posix_transport::~S8_posix_transport() {
+    end();
+}
+
+
+/* Open and configure port in raw mode, 9600 8N1, no flow control */
+bool S8_posix_transport::begin() {
+    struct termios tty;
+
+    if (port_fd < 0 && device != NULL) {
+        port_fd = open(device, O_RDWR | O_NOCTTY | O_NONBLOCK);
+        if (port_fd < 0) {
+            LOG_DEBUG_ERROR("Error opening serial port!");
+            return false;
+        }
+        owner = true;
+    }
+
+    if (port_fd < 0) {
+        return false;
+    }
+
+    hung_up = false;
+    port_error = false;
+    fcntl(port_fd, F_SETFL, fcntl(port_fd, F_GETFL) | O_NONBLOCK);
+
+    if (tcgetattr(port_fd, &tty) != 0) {
+        LOG_DEBUG_ERROR("Error getting serial port attributes!");
+        return false;
+    }
+
+    cfmakeraw(&tty);
+    cfsetispeed(&tty, B9600);
+    cfsetospeed(&tty, B9600);
+    tty.c_cflag &= ~(CSIZE | PARENB | CSTOPB | CRTSCTS);
+    tty.c_cflag |= CS8 | CLOCAL | CREAD;
+    tty.c_cc[VMIN] = 0;         // Reads never block, timeouts are done with poll()
+    tty.c_cc[VTIME] = 0;
+
+    if (tcsetattr(port_fd, TCSANOW, &tty) != 0) {
+        LOG_DEBUG_ERROR("Error setting serial port attributes!");
+        return false;
+    }
+
+    tcflush(port_fd, TCIOFLUSH);
+
+    return true;
+}
+
+
+void S8_posix_transport::end() {
+    if (owner && port_fd >= 0) {
+        close(port_fd);
+        port_fd = -1;
+        owner = false;
+    }
+}
+
+
+/* Write all bytes, waiting while the output queue is full at most write_timeout (ex: stalled USB adapter) */
+uint8_t S8_posix_transport::write(const uint8_t *buf, uint8_t size) {
+    uint8_t sent = 0;
+    uint32_t start_t = millis();
+
+    while (sent < size) {
+        ssize_t n = ::write(port_fd, buf + sent, size - sent);
+
+        if (n > 0) {
+            sent += n;
+
+        } else if (n < 0 && (errno == EAGAIN || errno == EINTR)) {
+            uint32_t elapsed = millis() - start_t;
+            if (elapsed >= write_timeout) {
+                LOG_DEBUG_ERROR("Timeout writing serial port!");
+                break;
+            }
+            struct pollfd pfd = { port_fd, POLLOUT, 0 };
+            poll(&pfd, 1, write_timeout - elapsed);
+
+        } else {
+            LOG_DEBUG_ERROR("Error writing serial port!");
+            break;
+        }
+    }
+
+    return sent;
+}
+
+
+void S8_posix_transport::flush() {
+    tcdrain(port_fd);
+}
+
+
+/* Nothing left in the output queue of the driver */
+bool S8_posix_transport::tx_done() {
+    int nb = 0;
+
+    if (ioctl(port_fd, TIOCOUTQ, &nb) != 0) {
+        return true;
+    }
+
+    return nb == 0;
+}
+
+
+int S8_posix_transport::available() {
+    int nb = 0;
+
+    if (ioctl(port_fd, FIONREAD, &nb) != 0) {
+        return 0;
+    }
+
+    return nb;
+}
+
+
+uint8_t S8_posix_transport::read(uint8_t *buf, uint8_t max_bytes) {
+    ssize_t n = ::read(port_fd, buf, max_bytes);
+
+    return n > 0 ? n : 0;
+}
+
+
+/* Sleep in poll() until data is received, a hang-up or an error of the port returns at once (see failed()) */
+bool S8_posix_transport::wait(uint32_t timeout_ms) {
+    struct pollfd pfd = { port_fd, POLLIN, 0 };
+    int n;
+
+    do {
+        n = poll(&pfd, 1, timeout_ms);
+    } while (n < 0 && errno == EINTR);
+
+    // A pseudo-terminal reports POLLERR with the hang-up, it is not an error of the port
+    if (n > 0 && (pfd.revents & POLLHUP)) {
+        if (!hung_up) {
+            LOG_DEBUG_ERROR("Serial port hung up!");
+            hung_up = true;
+        }
+    } else if (n > 0 && (pfd.revents & (POLLERR | POLLNVAL))) {
+        if (!port_error) {
+            LOG_DEBUG_ERROR("Error in serial port!");
+            port_error = true;
+        }
+    }
+
+    if (hung_up || port_error) {
+        return available() > 0;         // Bytes received before the hang-up can still be read
+    }
+
+    return n > 0 && (pfd.revents & POLLIN);
+}
+
+#endif
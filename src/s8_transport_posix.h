@@ -0,0 +1,76 @@
+/***************************************************************************************************************************
+
+	POSIX Serial Transport (Linux, ...)
+
+	Copyright (c) 2021 Josep Comas
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+	SOFTWARE.
+
+***************************************************************************************************************************/
+
+
+#ifndef _S8_TRANSPORT_POSIX_H
+    #define _S8_TRANSPORT_POSIX_H
+
+    #include "s8_transport.h"
+
+    #if defined(S8_HOST) && (defined(__unix__) || defined(__APPLE__))
+
+    #define S8_HAS_POSIX_TRANSPORT
+
+
+    /*
+        Serial port of a host (ex: /dev/ttyUSB0 with a USB-serial adapter) configured with termios in raw mode,
+        9600 8N1. The file descriptor is non-blocking, waits are done with poll().
+    */
+    class S8_posix_transport : public S8_transport
+    {
+        public:
+            S8_posix_transport(const char *device);                                 // Serial device (opened by begin)
+            S8_posix_transport(int fd);                                             // Already opened descriptor (ex: pseudo-terminal)
+            ~S8_posix_transport();
+
+            bool begin();                                                           // Open (if needed) and configure port
+            void end();                                                             // Close port (if opened by begin)
+            int fd() const { return port_fd; }                                      // Descriptor to use with poll/epoll
+            void set_write_timeout(uint32_t timeout_ms) { write_timeout = timeout_ms; }  // Max wait of write() while output is full (default S8_TIMEOUT)
+
+            uint8_t write(const uint8_t *buf, uint8_t size) override;
+            void flush() override;
+            int available() override;
+            uint8_t read(uint8_t *buf, uint8_t max_bytes) override;
+            bool wait(uint32_t timeout_ms) override;
+            bool tx_done() override;
+            bool failed() override { return hung_up || port_error; }
+
+            bool hangup() const { return hung_up; }                                 // Other side closed (POLLHUP), ex: adapter unplugged
+            bool error() const { return port_error; }                               // Error in the descriptor (POLLERR, POLLNVAL)
+
+        private:
+            const char *device;
+            int port_fd;
+            bool owner;                                                             // Descriptor opened by begin
+            uint32_t write_timeout;
+            bool hung_up;
+            bool port_error;
+    };
+
+    #endif
+
+#endif
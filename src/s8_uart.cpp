@@ -30,16 +30,124 @@
 #include "utils.h"
 
 
+#ifndef S8_HOST
+
 /* Initialize */
-S8_UART::S8_UART(Stream &serial)
+S8_UART::S8_UART(Stream &serial) : stream_transport(&serial)
+{
+    transport = &stream_transport;
+    tr_status = S8_TRANSACTION_IDLE;
+    cache = NULL;
+    timeout = S8_TIMEOUT;
+    tx_flush = true;
+    reset_link_stats();
+}
+
+
+/* Initialize with a transport backend (ESP32 UART events, RP2040 UART interrupt, mock, ...) */
+S8_UART::S8_UART(S8_transport &transport) : stream_transport(NULL)
 {
-    mySerial = &serial;
+    this->transport = &transport;
+    tr_status = S8_TRANSACTION_IDLE;
+    cache = NULL;
+    timeout = S8_TIMEOUT;
+    tx_flush = true;
+    reset_link_stats();
+}
+
+#else
+
+/* Initialize with a transport backend (POSIX serial port, mock, ...) */
+S8_UART::S8_UART(S8_transport &transport)
+{
+    this->transport = &transport;
+    tr_status = S8_TRANSACTION_IDLE;
+    cache = NULL;
+    timeout = S8_TIMEOUT;
+    tx_flush = true;
+    reset_link_stats();
+}
+
+#endif
+
+
+/* Check if a sensor answers */
+uint8_t S8_UART::probe(uint32_t timeout_ms) {
+
+    S8_UART *sensors[1] = { this };
+    uint8_t result;
+
+    probe_all(sensors, 1, &result, timeout_ms);
+    return result;
+}
+
+
+/* Probe several sensors (in different ports) at the same time, total time is at most timeout_ms */
+void S8_UART::probe_all(S8_UART *sensors[], uint8_t count, uint8_t results[], uint32_t timeout_ms) {
+
+    uint8_t pending = 0;
+
+    // Discard old bytes (if there are bytes without request, the line is noisy) and send requests
+    for (uint8_t i = 0; i < count; i++) {
+        results[i] = (sensors[i]->drain() > 0) ? S8_PROBE_NOISE : S8_PROBE_SILENT;
+        if (sensors[i]->request_read<S8_reg_firmware_version>()) {
+            pending++;
+        }
+    }
+
+    uint32_t start_t = millis();
+
+    while (pending > 0) {
+        bool expired = (millis() - start_t) > timeout_ms;
+
+        for (uint8_t i = 0; i < count; i++) {
+            S8_UART *sensor = sensors[i];
+
+            if (sensor->tr_status != S8_TRANSACTION_PENDING) {
+                continue;
+            }
+
+            uint8_t status = sensor->poll_transaction();
+
+            if (status == S8_TRANSACTION_PENDING && expired) {
+                sensor->cancel_transaction();
+                status = S8_TRANSACTION_TIMEOUT;
+            }
+
+            if (status == S8_TRANSACTION_DONE) {
+                results[i] = S8_PROBE_FOUND;
+            } else if (status == S8_TRANSACTION_ERROR ||
+                       (status == S8_TRANSACTION_TIMEOUT && sensor->tr_received + sensor->tr_discarded > 0)) {
+                results[i] = S8_PROBE_NOISE;
+            }
+
+            if (status != S8_TRANSACTION_PENDING) {
+                pending--;
+            }
+        }
+
+        if (pending > 0) {
+            yield();
+        }
+    }
+
+    for (uint8_t i = 0; i < count; i++) {
+        if (results[i] == S8_PROBE_FOUND) {
+            LOG_DEBUG_INFO("Sensor found");
+        } else if (results[i] == S8_PROBE_NOISE) {
+            LOG_DEBUG_ERROR("Noise in the line, no valid response!");
+        } else {
+            LOG_DEBUG_ERROR("No response!");
+        }
+    }
 }
 
 
 /* Get firmware version */
 void S8_UART::get_firmware_version(char firmver[]) {
 
+    int16_t version;
+
     if (firmver == NULL) {
         return;
     }
@@ -47,15 +155,8 @@ void S8_UART::get_firmware_version(char firmver[]) {
     strcpy(firmver, "");
 
     // Ask software version
-    send_cmd(MODBUS_FUNC_READ_INPUT_REGISTERS, MODBUS_IR29, 0x0001);
-
-    // Wait response
-    memset(buf_msg, 0, S8_LEN_BUF_MSG);
-    uint8_t nb = serial_read_bytes(7, S8_TIMEOUT);
-
-    // Check response and get data
-    if (valid_response_len(MODBUS_FUNC_READ_INPUT_REGISTERS, nb, 7)) {
-        snprintf(firmver, S8_LEN_FIRMVER, "%0u.%0u", buf_msg[3], buf_msg[4]);
+    if (read_register<S8_reg_firmware_version>(version)) {
+        snprintf(firmver, S8_LEN_FIRMVER, "%0u.%0u", (version >> 8) & 0x00FF, version & 0x00FF);
         LOG_DEBUG_INFO("Firmware version: ", firmver);
 
     } else {
@@ -71,15 +172,7 @@ int16_t S8_UART::get_co2() {
     int16_t co2 = 0;
 
     // Ask CO2 value
-    send_cmd(MODBUS_FUNC_READ_INPUT_REGISTERS, MODBUS_IR4, 0x0001);
-
-    // Wait response
-    memset(buf_msg, 0, S8_LEN_BUF_MSG);
-    uint8_t nb = serial_read_bytes(7, S8_TIMEOUT);
-
-    // Check response and get data
-    if (valid_response_len(MODBUS_FUNC_READ_INPUT_REGISTERS, nb, 7)) {
-        co2 = ((buf_msg[3] << 8) & 0xFF00) | (buf_msg[4] & 0x00FF);
+    if (read_register<S8_reg_co2>(co2)) {
         LOG_DEBUG_INFO("CO2 value = ", co2, " ppm");
 
     } else {
@@ -96,15 +189,7 @@ int16_t S8_UART::get_ABC_period() {
     int16_t period = 0;
 
     // Ask ABC period
-    send_cmd(MODBUS_FUNC_READ_HOLDING_REGISTERS, MODBUS_HR32, 0x0001);
-
-    // Wait response
-    memset(buf_msg, 0, S8_LEN_BUF_MSG);
-    uint8_t nb = serial_read_bytes(7, S8_TIMEOUT);
-
-    // Check response and get data
-    if (valid_response_len(MODBUS_FUNC_READ_HOLDING_REGISTERS, nb, 7)) {
-        period = ((buf_msg[3] << 8) & 0xFF00) | (buf_msg[4] & 0x00FF);
+    if (read_register<S8_reg_abc_period>(period)) {
         LOG_DEBUG_INFO("ABC period = ", period, " hours");
 
     } else {
@@ -117,24 +202,14 @@ int16_t S8_UART::get_ABC_period() {
 
 /* Setup ABC period, default 180 hours (7.5 days) */
 bool S8_UART::set_ABC_period(int16_t period) {
-    uint8_t buf_msg_sent[8];
     bool result = false;
 
     if (period >= 0 && period <= 4800) {   // 0 = disable ABC algorithm
 
         // Ask set ABC period
-        send_cmd(MODBUS_FUNC_WRITE_SINGLE_REGISTER, MODBUS_HR32, period);
-
-        // Save bytes sent
-        memcpy(buf_msg_sent, buf_msg, 8);
+        result = write_register(MODBUS_HR32, period);
 
-        // Wait response
-        memset(buf_msg, 0, S8_LEN_BUF_MSG);
-        serial_read_bytes(8, S8_TIMEOUT);
-
-        // Check response
-        if (memcmp(buf_msg_sent, buf_msg, 8) == 0) {
-            result = true;
+        if (result) {
             LOG_DEBUG_INFO("Successful setting of ABC period");
 
         } else {
@@ -149,21 +224,54 @@ bool S8_UART::set_ABC_period(int16_t period) {
 }
 
 
+/* Setup ABC period only if it is different (avoids a write in the EEPROM of the sensor at every boot) */
+uint8_t S8_UART::apply_ABC_period(int16_t period) {
+
+    int16_t current;
+
+    if (period < 0 || period > 4800) {
+        LOG_DEBUG_ERROR("Invalid ABC period!");
+        return S8_CONFIG_ERROR;
+    }
+
+    // Current value (from cache if it is enabled)
+    if (!read_register<S8_reg_abc_period>(current)) {
+        LOG_DEBUG_ERROR("Error getting ABC period!");
+        return S8_CONFIG_ERROR;
+    }
+
+    if (current == period) {
+        LOG_DEBUG_INFO("ABC period already set");
+        return S8_CONFIG_UNCHANGED;
+    }
+
+    if (!write_register(MODBUS_HR32, period)) {
+        LOG_DEBUG_ERROR("Error in setting of ABC period!");
+        return S8_CONFIG_ERROR;
+    }
+
+    // Verify with the sensor (not with the cache)
+    if (!read_registers(S8_reg_abc_period::func, S8_reg_abc_period::addr, S8_reg_abc_period::words) ||
+        S8_reg_abc_period::decode(&buf_msg[3]) != period) {
+        LOG_DEBUG_ERROR("ABC period not verified!");
+        if (cache != NULL) {
+            cache->clear();
+        }
+        return S8_CONFIG_ERROR;
+    }
+
+    LOG_DEBUG_INFO("Successful setting of ABC period");
+    return S8_CONFIG_WRITTEN;
+}
+
+
 /* Read acknowledgement flags */
 int16_t S8_UART::get_acknowledgement() {
 
     int16_t flags = 0;
 
     // Ask acknowledgement flags
-    send_cmd(MODBUS_FUNC_READ_HOLDING_REGISTERS, MODBUS_HR1, 0x0001);
-
-    // Wait response
-    memset(buf_msg, 0, S8_LEN_BUF_MSG);
-    uint8_t nb = serial_read_bytes(7, S8_TIMEOUT);
-
-    // Check response and get data
-    if (valid_response_len(MODBUS_FUNC_READ_HOLDING_REGISTERS, nb, 7)) {
-        flags = ((buf_msg[3] << 8) & 0xFF00) | (buf_msg[4] & 0x00FF);
+    if (read_register<S8_reg_acknowledgement>(flags)) {
         LOG_DEBUG_INFO_BINARY("Acknowledgement flags = b", flags);
 
     } else {
@@ -176,22 +284,11 @@ int16_t S8_UART::get_acknowledgement() {
 
 /* Read acknowledgement flags */
 bool S8_UART::clear_acknowledgement() {
-    uint8_t buf_msg_sent[8];
-    bool result = false;
 
     // Ask clear acknowledgement flags
-    send_cmd(MODBUS_FUNC_WRITE_SINGLE_REGISTER, MODBUS_HR1, 0x0000);
+    bool result = write_register(MODBUS_HR1, 0x0000);
 
-    // Save bytes sent
-    memcpy(buf_msg_sent, buf_msg, 8);
-
-    // Wait response
-    memset(buf_msg, 0, S8_LEN_BUF_MSG);
-    serial_read_bytes(8, S8_TIMEOUT);
-
-    // Check response
-    if (memcmp(buf_msg_sent, buf_msg, 8) == 0) {
-        result = true;
+    if (result) {
         LOG_DEBUG_INFO("Successful clearing acknowledgement flags");
 
     } else {
@@ -229,22 +326,11 @@ bool S8_UART::manual_calibration() {
    Parameter = 0x07 CO2 zero calibration
 */
 bool S8_UART::send_special_command(int16_t command) {
-    uint8_t buf_msg_sent[8];
-    bool result = false;
 
     // Ask set user special command
-    send_cmd(MODBUS_FUNC_WRITE_SINGLE_REGISTER, MODBUS_HR2, command);
-
-    // Save bytes sent
-    memcpy(buf_msg_sent, buf_msg, 8);
+    bool result = write_register(MODBUS_HR2, command);
 
-    // Wait response
-    memset(buf_msg, 0, S8_LEN_BUF_MSG);
-    serial_read_bytes(8, S8_TIMEOUT);
-
-    // Check response
-    if (memcmp(buf_msg_sent, buf_msg, 8) == 0) {
-        result = true;
+    if (result) {
         LOG_DEBUG_INFO("Successful setting user special command");
 
     } else {
@@ -261,15 +347,7 @@ int16_t S8_UART::get_meter_status() {
     int16_t status = 0;
 
     // Ask meter status
-    send_cmd(MODBUS_FUNC_READ_INPUT_REGISTERS, MODBUS_IR1, 0x0001);
-
-    // Wait response
-    memset(buf_msg, 0, S8_LEN_BUF_MSG);
-    uint8_t nb = serial_read_bytes(7, S8_TIMEOUT);
-
-    // Check response and get data
-    if (valid_response_len(MODBUS_FUNC_READ_INPUT_REGISTERS, nb, 7)) {
-        status = ((buf_msg[3] << 8) & 0xFF00) | (buf_msg[4] & 0x00FF);
+    if (read_register<S8_reg_meter_status>(status)) {
         LOG_DEBUG_INFO_BINARY("Meter status = b", status);
 
     } else {
@@ -286,15 +364,7 @@ int16_t S8_UART::get_alarm_status() {
     int16_t status = 0;
 
     // Ask alarm status
-    send_cmd(MODBUS_FUNC_READ_INPUT_REGISTERS, MODBUS_IR2, 0x0001);
-
-    // Wait response
-    memset(buf_msg, 0, S8_LEN_BUF_MSG);
-    uint8_t nb = serial_read_bytes(7, S8_TIMEOUT);
-
-    // Check response and get data
-    if (valid_response_len(MODBUS_FUNC_READ_INPUT_REGISTERS, nb, 7)) {
-        status = ((buf_msg[3] << 8) & 0xFF00) | (buf_msg[4] & 0x00FF);
+    if (read_register<S8_reg_alarm_status>(status)) {
         LOG_DEBUG_INFO_BINARY("Alarm status = b", status);
 
     } else {
@@ -311,15 +381,7 @@ int16_t S8_UART::get_output_status() {
     int16_t status = 0;
 
     // Ask output status
-    send_cmd(MODBUS_FUNC_READ_INPUT_REGISTERS, MODBUS_IR3, 0x0001);
-
-    // Wait response
-    memset(buf_msg, 0, S8_LEN_BUF_MSG);
-    uint8_t nb = serial_read_bytes(7, S8_TIMEOUT);
-
-    // Check response and get data
-    if (valid_response_len(MODBUS_FUNC_READ_INPUT_REGISTERS, nb, 7)) {
-        status = ((buf_msg[3] << 8) & 0xFF00) | (buf_msg[4] & 0x00FF);
+    if (read_register<S8_reg_output_status>(status)) {
         LOG_DEBUG_INFO_BINARY("Output status = b", status);
 
     } else {
@@ -339,17 +401,9 @@ int16_t S8_UART::get_PWM_output() {
     int16_t pwm = 0;
 
     // Ask PWM output
-    send_cmd(MODBUS_FUNC_READ_INPUT_REGISTERS, MODBUS_IR22, 0x0001);
-
-    // Wait response
-    memset(buf_msg, 0, S8_LEN_BUF_MSG);
-    uint8_t nb = serial_read_bytes(7, S8_TIMEOUT);
-
-    // Check response and get data
-    if (valid_response_len(MODBUS_FUNC_READ_INPUT_REGISTERS, nb, 7)) {
-        pwm = ((buf_msg[3] << 8) & 0xFF00) | (buf_msg[4] & 0x00FF);
+    if (read_register<S8_reg_pwm_output>(pwm)) {
         LOG_DEBUG_INFO("PWM output (raw) = ", pwm);
-        LOG_DEBUG_INFO("PWM output (to ppm, normal version) = ", (pwm / 16383.0) * 2000.0, " ppm");
+        LOG_DEBUG_INFO("PWM output (to ppm, normal version) = ", S8_reg_pwm_output::scale(pwm), " ppm");
         //LOG_DEBUG_INFO("PWM output (to ppm, extended version) = ", (pwm / 16383.0) * 10000.0, " ppm");
 
     } else {
@@ -360,114 +414,221 @@ int16_t S8_UART::get_PWM_output() {
 }
 
 
-/* Read sensor type ID */
+/* Read sensor type ID (IR26 and IR27 in one transaction) */
 int32_t S8_UART::get_sensor_type_ID() {
 
     int32_t sensorType = 0;
 
-    // Ask sensor type ID (high)
-    send_cmd(MODBUS_FUNC_READ_INPUT_REGISTERS, MODBUS_IR26, 0x0001);
+    // Ask sensor type ID
+    if (read_register<S8_reg_sensor_type_id>(sensorType)) {
+        LOG_DEBUG_INFO_HEX("Sensor type ID = 0x", sensorType, 3);
 
-    // Wait response
-    memset(buf_msg, 0, S8_LEN_BUF_MSG);
-    uint8_t nb = serial_read_bytes(7, S8_TIMEOUT);
+    } else {
+        LOG_DEBUG_ERROR("Error getting sensor type ID!");
+    }
 
-    // Check response and get data
-    if (valid_response_len(MODBUS_FUNC_READ_INPUT_REGISTERS, nb, 7)) {
+    return sensorType;
+}
+
+
+/* Read sensor ID (IR30 and IR31 in one transaction) */
+int32_t S8_UART::get_sensor_ID() {
 
-        // Save sensor type ID (high)
-        sensorType = (((int32_t)buf_msg[4] << 16) & 0x00FF0000);
+    int32_t sensorID = 0;
 
-        // Ask sensor type ID (low)
-        send_cmd(MODBUS_FUNC_READ_INPUT_REGISTERS, MODBUS_IR27, 0x0001);
+    // Ask sensor ID
+    if (read_register<S8_reg_sensor_id>(sensorID)) {
+        LOG_DEBUG_INFO_HEX("Sensor ID = 0x", sensorID, 4);
 
-        // Wait response
-        memset(buf_msg, 0, S8_LEN_BUF_MSG);
-        nb = serial_read_bytes(7, S8_TIMEOUT);
+    } else {
+        LOG_DEBUG_ERROR("Error getting sensor ID!");
+    }
 
-        // Check response and get data
-        if (valid_response_len(MODBUS_FUNC_READ_INPUT_REGISTERS, nb, 7)) {
+    return sensorID;
+}
 
-            sensorType |= ((buf_msg[3] << 8) & 0x0000FF00) | (buf_msg[4] & 0x000000FF);
-            LOG_DEBUG_INFO_HEX("Sensor type ID = 0x", sensorType, 3);
 
-        } else {
-            LOG_DEBUG_ERROR("Error getting sensor type ID (low)!");
-        }
+/* Read memory map version */
+int16_t S8_UART::get_memory_map_version() {
+
+    int16_t mmVersion = 0;
+
+    // Ask memory map version
+    if (read_register<S8_reg_memory_map_version>(mmVersion)) {
+        LOG_DEBUG_INFO("Memory map version = ", mmVersion);
 
     } else {
-        LOG_DEBUG_ERROR("Error getting sensor type ID (high)!");
+        LOG_DEBUG_ERROR("Error getting memory map version!");
     }
 
-    return sensorType;
+    return mmVersion;
 }
 
 
-/* Read sensor ID */
-int32_t S8_UART::get_sensor_ID() {
+/* Read every documented register, consecutive registers in one transaction. The reserved gaps of the memory map
+   (IR5-IR21, IR23-IR25, HR3-HR31) are not read, the sensor does not answer them */
+uint8_t S8_UART::dump(S8_dump &dump) {
 
-    int32_t sensorID = 0;
+    typedef S8_block<S8_reg_meter_status, S8_reg_co2> measures;
+    typedef S8_block<S8_reg_sensor_type_id, S8_reg_sensor_id> identity;
+    typedef S8_block<S8_reg_acknowledgement, S8_reg_special_command> commands;
+
+    static const struct { uint8_t block; uint8_t func; uint16_t addr; uint8_t words; } blocks[] = {
+        { S8_DUMP_MEASURES, measures::func, measures::addr, measures::words },
+        { S8_DUMP_PWM, S8_reg_pwm_output::func, S8_reg_pwm_output::addr, S8_reg_pwm_output::words },
+        { S8_DUMP_IDENTITY, identity::func, identity::addr, identity::words },
+        { S8_DUMP_COMMANDS, commands::func, commands::addr, commands::words },
+        { S8_DUMP_ABC, S8_reg_abc_period::func, S8_reg_abc_period::addr, S8_reg_abc_period::words }
+    };
+
+    memset(&dump, 0, sizeof(dump));
 
-    // Ask sensor ID (high)
-    send_cmd(MODBUS_FUNC_READ_INPUT_REGISTERS, MODBUS_IR30, 0x0001);
+    for (uint8_t i = 0; i < sizeof(blocks) / sizeof(blocks[0]); i++) {
+        uint32_t timeouts = stats.timeouts;
+
+        dump.transactions++;
+        if (!read_registers(blocks[i].func, blocks[i].addr, blocks[i].words)) {
+            if (stats.timeouts != timeouts) {
+                LOG_DEBUG_ERROR("Dump aborted, no response!");
+                break;      // Do not wait the timeout of every block
+            }
+            continue;
+        }
+
+        const uint8_t *data = &buf_msg[3];
+        int16_t version;
+
+        switch (blocks[i].block) {
+            case S8_DUMP_MEASURES:
+                dump.meter_status = measures::decode<S8_reg_meter_status>(data);
+                dump.alarm_status = measures::decode<S8_reg_alarm_status>(data);
+                dump.output_status = measures::decode<S8_reg_output_status>(data);
+                dump.co2 = measures::decode<S8_reg_co2>(data);
+                break;
+
+            case S8_DUMP_PWM:
+                dump.pwm_output = S8_reg_pwm_output::decode(data);
+                break;
+
+            case S8_DUMP_IDENTITY:
+                dump.sensor_type_id = identity::decode<S8_reg_sensor_type_id>(data);
+                dump.map_version = identity::decode<S8_reg_memory_map_version>(data);
+                version = identity::decode<S8_reg_firmware_version>(data);
+                snprintf(dump.firm_version, S8_LEN_FIRMVER, "%0u.%0u", (version >> 8) & 0x00FF, version & 0x00FF);
+                dump.sensor_id = identity::decode<S8_reg_sensor_id>(data);
+                break;
+
+            case S8_DUMP_COMMANDS:
+                dump.ack = commands::decode<S8_reg_acknowledgement>(data);
+                dump.special_command = commands::decode<S8_reg_special_command>(data);
+                break;
+
+            case S8_DUMP_ABC:
+                dump.abc_period = S8_reg_abc_period::decode(data);
+                break;
+        }
+
+        dump.valid |= blocks[i].block;
+    }
+
+    return dump.valid;
+}
+
+
+/* Read consecutive registers, data of the response starts at buf_msg[3] */
+bool S8_UART::read_registers(uint8_t func, uint16_t reg, uint8_t words) {
+
+    uint32_t start_us = micros();
+
+    // Ask registers
+    send_cmd(func, reg, words);
 
     // Wait response
-    memset(buf_msg, 0, S8_LEN_BUF_MSG);
-    uint8_t nb = serial_read_bytes(7, S8_TIMEOUT);
+    uint8_t status = receive_frame(5 + words * 2);
+    count_transaction(status, start_us);
+
+    return status == S8_TRANSACTION_DONE;
+}
 
-    // Check response and get data
-    if (valid_response_len(MODBUS_FUNC_READ_INPUT_REGISTERS, nb, 7)) {
 
-        // Save sensor ID (high)
-        sensorID = (((int32_t)buf_msg[3] << 24) & 0xFF000000) | (((int32_t)buf_msg[4] << 16) & 0x00FF0000);
+/* Write a holding register, the sensor answers with an echo of the request */
+bool S8_UART::write_register(uint16_t reg, uint16_t value) {
 
-        // Ask sensor ID (low)
-        send_cmd(MODBUS_FUNC_READ_INPUT_REGISTERS, MODBUS_IR31, 0x0001);
+    uint32_t start_us = micros();
 
-        // Wait response
-        memset(buf_msg, 0, S8_LEN_BUF_MSG);
-        nb = serial_read_bytes(7, S8_TIMEOUT);
+    // Ask write register
+    send_cmd(MODBUS_FUNC_WRITE_SINGLE_REGISTER, reg, value);
 
-        // Check response and get data
-        if (valid_response_len(MODBUS_FUNC_READ_INPUT_REGISTERS, nb, 7)) {
+    // Wait echo
+    uint8_t status = receive_frame(8);
+    count_transaction(status, start_us);
 
-            sensorID |= ((buf_msg[3] << 8) & 0x0000FF00) | (buf_msg[4] & 0x000000FF);
-            LOG_DEBUG_INFO_HEX("Sensor ID = 0x", sensorID, 4);
+    bool result = (status == S8_TRANSACTION_DONE);
 
+    if (cache != NULL) {
+        if (result) {
+            cache->written(reg, value);
         } else {
-            LOG_DEBUG_ERROR("Error getting sensor ID (low)!");
+            cache->clear();     // Unknown state of sensor
         }
-
-    } else {
-        LOG_DEBUG_ERROR("Error getting sensor ID (high)!");
     }
 
-    return sensorID;
+    return result;
 }
 
 
-/* Read memory map version */
-int16_t S8_UART::get_memory_map_version() {
-
-    int16_t mmVersion = 0;
+/* Wait the response to buf_req, bytes before it (late answer of a previous request, noise) are discarded */
+uint8_t S8_UART::receive_frame(uint8_t len) {
 
-    // Ask memory map version
-    send_cmd(MODBUS_FUNC_READ_INPUT_REGISTERS, MODBUS_IR28, 0x0001);
+    uint32_t start_t = millis();
+    uint32_t elapsed = 0;
+    uint8_t nb = 0;
 
-    // Wait response
     memset(buf_msg, 0, S8_LEN_BUF_MSG);
-    uint8_t nb = serial_read_bytes(7, S8_TIMEOUT);
+    tr_discarded = 0;
 
-    // Check response and get data
-    if (valid_response_len(MODBUS_FUNC_READ_INPUT_REGISTERS, nb, 7)) {
-        mmVersion = ((buf_msg[3] << 8) & 0xFF00) | (buf_msg[4] & 0x00FF);
-        LOG_DEBUG_INFO("Memory map version = ", mmVersion);
+    while (elapsed < timeout) {
+        // Header first, an exception response (function | 0x80) has only 5 bytes
+        uint8_t want = (nb < 3) ? 3 : ((buf_msg[1] & 0x80) ? 5 : len);
+        nb = serial_read_bytes(nb, want, timeout - elapsed);
+        bool timed_out = (nb < want);
 
-    } else {
-        LOG_DEBUG_ERROR("Error getting memory map version!");
+        if (resync(nb, len)) {
+            return check_frame(nb, len);
+        }
+        if (timed_out) {
+            break;
+        }
+        elapsed = millis() - start_t;
     }
 
-    return mmVersion;
+    return transport->failed() ? S8_TRANSACTION_ERROR : S8_TRANSACTION_TIMEOUT;
+}
+
+
+/* Discard received bytes */
+uint8_t S8_UART::drain() {
+
+    uint8_t discard[S8_LEN_BUF_MSG];        // Keep data of last response in buf_msg
+    uint16_t nb = 0;
+    uint8_t n;
+
+    // Limited, a noisy line could send bytes forever
+    while (nb < 255 && transport->available() > 0 && (n = transport->read(discard, sizeof(discard))) > 0) {
+        nb += n;
+    }
+
+    return (nb > 255) ? 255 : nb;
+}
+
+
+/* Discard bytes received outside a transaction (counted as discarded bytes) */
+uint8_t S8_UART::discard_input() {
+
+    uint8_t nb = drain();
+    stats.discarded_bytes += nb;
+
+    return nb;
 }
 
 
@@ -516,8 +677,96 @@ bool S8_UART::valid_response(uint8_t func, uint8_t nb) {
 }
 
 
-/* Send command */
-void S8_UART::send_cmd( uint8_t func, uint16_t reg, uint16_t value) {
+/* Check if bytes can be the start of the response to buf_req, returns 0 if not, 1 if more bytes are
+   needed or the length of the complete response (len, or 5 for an exception response) */
+uint8_t S8_UART::match_frame(uint8_t *frame, uint8_t avail, uint8_t len) {
+
+    uint8_t func = buf_req[1];
+
+    if (frame[0] != MODBUS_ANY_ADDRESS) {
+        return 0;
+    }
+
+    // Exception response: address, function | 0x80, exception code, CRC
+    if (avail >= 2 && frame[1] == (func | 0x80)) {
+        if (avail < 5) {
+            return 1;
+        }
+        uint16_t crc16 = modbus_CRC16(frame, 3);
+        return (frame[3] == (crc16 & 0x00FF) && frame[4] == ((crc16 >> 8) & 0x00FF)) ? 5 : 0;
+    }
+
+    // Echo of a write
+    if (func == MODBUS_FUNC_WRITE_SINGLE_REGISTER) {
+        uint8_t n = (avail < 8) ? avail : 8;
+        if (memcmp(frame, buf_req, n) != 0) {
+            return 0;
+        }
+        return (n == 8) ? 8 : 1;
+    }
+
+    // Response of a read: address, function, number of bytes, data, CRC
+    if ((avail >= 2 && frame[1] != func) || (avail >= 3 && frame[2] != len - 5)) {
+        return 0;
+    }
+    if (avail < len) {
+        return 1;
+    }
+    uint16_t crc16 = modbus_CRC16(frame, len - 2);
+    return (frame[len-2] == (crc16 & 0x00FF) && frame[len-1] == ((crc16 >> 8) & 0x00FF)) ? len : 0;
+}
+
+
+/* Move the first candidate of the response to the start of buf_msg, returns true if it is complete */
+bool S8_UART::resync(uint8_t &nb, uint8_t len) {
+
+    uint8_t i = 0;
+    uint8_t m = 0;
+
+    while (i < nb && (m = match_frame(&buf_msg[i], nb - i, len)) == 0) {
+        i++;
+    }
+
+    if (i > 0) {
+        LOG_DEBUG_WARN("Discarded bytes before response: ", i);
+        if (tr_discarded == 0) {
+            stats.resyncs++;                // Once per transaction, bytes can arrive in several reads
+        }
+        stats.discarded_bytes += i;
+        tr_discarded += i;
+        memmove(buf_msg, &buf_msg[i], nb - i);
+        nb -= i;
+    }
+
+    if (m > 1) {
+        nb = m;
+        return true;
+    }
+
+    return false;
+}
+
+
+/* Status of a complete response in buf_msg */
+uint8_t S8_UART::check_frame(uint8_t nb, uint8_t len) {
+
+    LOG_DEBUG_VERBOSE_PACKET("Response: ", (char *)buf_msg, nb);
+
+    if (nb != len) {
+        LOG_DEBUG_ERROR("Exception response: ", buf_msg[2]);
+        return S8_TRANSACTION_ERROR;
+    }
+
+    if (buf_req[1] == MODBUS_FUNC_WRITE_SINGLE_REGISTER) {
+        return S8_TRANSACTION_DONE;     // match_frame compared the echo with the request
+    }
+
+    return valid_response(buf_req[1], nb) ? S8_TRANSACTION_DONE : S8_TRANSACTION_ERROR;
+}
+
+
+/* Build command in buffer */
+bool S8_UART::build_cmd(uint8_t func, uint16_t reg, uint16_t value) {
 
     uint16_t crc16;
 
@@ -531,46 +780,186 @@ void S8_UART::send_cmd( uint8_t func, uint16_t reg, uint16_t value) {
         crc16 = modbus_CRC16(buf_msg, 6);
         buf_msg[6] = crc16 & 0x00FF;
         buf_msg[7] = (crc16 >> 8) & 0x00FF;
+        memcpy(buf_req, buf_msg, 8);                    // Kept to match the response
+        return true;
+    }
+
+    return false;
+}
+
+
+/* Send command */
+void S8_UART::send_cmd( uint8_t func, uint16_t reg, uint16_t value) {
+
+    // Bytes received before the request can only be a late answer or noise
+    stats.discarded_bytes += drain();
+
+    if (build_cmd(func, reg, value)) {
         serial_write_bytes(8);
     }
 }
 
 
+/* Send request to read consecutive registers without waiting the response */
+bool S8_UART::request_read(uint8_t func, uint16_t reg, uint8_t words) {
+
+    if (tr_status == S8_TRANSACTION_PENDING || words == 0 || 5 + words * 2 > S8_LEN_BUF_MSG ||
+        (func != MODBUS_FUNC_READ_HOLDING_REGISTERS && func != MODBUS_FUNC_READ_INPUT_REGISTERS)) {
+        LOG_DEBUG_ERROR("Invalid request!");
+        return false;
+    }
+
+    stats.discarded_bytes += drain();
+    build_cmd(func, reg, words);
+    LOG_DEBUG_VERBOSE_PACKET("Bytes to send: ", (char *)buf_msg, 8);
+    transport->write(buf_msg, 8);
+
+    tr_func = func;
+    tr_expected = 5 + words * 2;
+    tr_received = 0;
+    tr_discarded = 0;
+    tr_start = millis();
+    tr_start_us = micros();
+    tr_status = S8_TRANSACTION_PENDING;
+
+    return true;
+}
+
+
+/* Send request to write a holding register without waiting the response */
+bool S8_UART::request_write(uint16_t reg, uint16_t value) {
+
+    if (tr_status == S8_TRANSACTION_PENDING) {
+        LOG_DEBUG_ERROR("Invalid request!");
+        return false;
+    }
+
+    stats.discarded_bytes += drain();
+    build_cmd(MODBUS_FUNC_WRITE_SINGLE_REGISTER, reg, value);
+    LOG_DEBUG_VERBOSE_PACKET("Bytes to send: ", (char *)buf_msg, 8);
+    transport->write(buf_msg, 8);
+
+    tr_func = MODBUS_FUNC_WRITE_SINGLE_REGISTER;
+    tr_expected = 8;
+    tr_received = 0;
+    tr_discarded = 0;
+    tr_start = millis();
+    tr_start_us = micros();
+    tr_status = S8_TRANSACTION_PENDING;
+
+    return true;
+}
+
+
+/* Collect received bytes of the pending transaction, it never blocks */
+uint8_t S8_UART::poll_transaction() {
+
+    if (tr_status != S8_TRANSACTION_PENDING) {
+        return tr_status;
+    }
+
+    uint8_t n = transport->read(&buf_msg[tr_received], tr_expected - tr_received);
+    tr_received += n;
+
+    if (n > 0 && resync(tr_received, tr_expected)) {
+        tr_status = check_frame(tr_received, tr_expected);
+        if (tr_func == MODBUS_FUNC_WRITE_SINGLE_REGISTER && cache != NULL && tr_status == S8_TRANSACTION_DONE) {
+            cache->written((buf_req[2] << 8) | buf_req[3], (buf_req[4] << 8) | buf_req[5]);
+        }
+        count_transaction(tr_status, tr_start_us);
+
+    } else if ((millis() - tr_start) > timeout) {
+        LOG_DEBUG_ERROR("Timeout reading serial port!");
+        tr_status = S8_TRANSACTION_TIMEOUT;
+        count_transaction(tr_status, tr_start_us);
+    }
+
+    return tr_status;
+}
+
+
+/* Wait until the pending transaction finishes, the transport sleeps while there are no bytes */
+uint8_t S8_UART::wait_transaction() {
+
+    while (poll_transaction() == S8_TRANSACTION_PENDING) {
+        uint32_t elapsed = millis() - tr_start;
+        if (!transport->wait((elapsed < timeout) ? timeout - elapsed : 1) && transport->failed()) {
+            cancel_transaction(S8_TRANSACTION_ERROR);
+        }
+    }
+
+    return tr_status;
+}
+
+
+/* Abort pending transaction (status S8_TRANSACTION_TIMEOUT or S8_TRANSACTION_ERROR) */
+void S8_UART::cancel_transaction(uint8_t status) {
+
+    if (tr_status == S8_TRANSACTION_PENDING) {
+        tr_status = status;
+        count_transaction(tr_status, tr_start_us);
+    }
+}
+
+
+/* Update counters of the link */
+void S8_UART::count_transaction(uint8_t status, uint32_t start_us) {
+
+    uint32_t latency_us = micros() - start_us;
+
+    stats.transactions++;
+    if (status == S8_TRANSACTION_ERROR) {
+        stats.errors++;
+    } else if (status == S8_TRANSACTION_TIMEOUT) {
+        stats.timeouts++;
+    }
+
+    stats.last_latency_us = latency_us;
+    if (latency_us > stats.max_latency_us) {
+        stats.max_latency_us = latency_us;
+    }
+    stats.total_latency_us += latency_us;
+}
+
+
+/* Clear counters of the link */
+void S8_UART::reset_link_stats() {
+    memset(&stats, 0, sizeof(stats));
+}
+
+
 /* Send bytes to sensor */
 void S8_UART::serial_write_bytes(uint8_t size) {
 
     LOG_DEBUG_VERBOSE_PACKET("Bytes to send: ", (char *)buf_msg, size);
 
-    mySerial->write(buf_msg, size);
-    mySerial->flush();
+    transport->write(buf_msg, size);
+    if (tx_flush) {
+        transport->flush();
+    }
 }
 
 
-/* Read answer of sensor */
-uint8_t S8_UART::serial_read_bytes(uint8_t max_bytes, uint32_t timeout_ms) {
+/* Read answer of sensor (until max_bytes are in the buffer or timeout), the first nb bytes are kept */
+uint8_t S8_UART::serial_read_bytes(uint8_t nb, uint8_t max_bytes, uint32_t timeout_ms) {
 
     uint32_t start_t = millis();
-    uint32_t end_t = start_t;
-    bool readed = false;
+    uint32_t elapsed = 0;
+    uint8_t start = nb;
 
-    uint8_t nb = 0;
-    if (max_bytes > 0 && timeout_ms > 0) {
+    if (max_bytes > nb && max_bytes <= S8_LEN_BUF_MSG && timeout_ms > 0) {
 
-        while (((end_t - start_t) <= timeout_ms) && !readed) {
-            if(mySerial->available()) {
-                nb = mySerial->readBytes(buf_msg, max_bytes);
-                readed = true;
+        while (nb < max_bytes && elapsed <= timeout_ms) {
+            if (transport->wait(timeout_ms - elapsed)) {
+                nb += transport->read(&buf_msg[nb], max_bytes - nb);
+            } else if (transport->failed()) {
+                break;                  // Port closed, waiting the timeout would spin
             }
-            end_t = millis();
+            elapsed = millis() - start_t;
         }
 
-        if (readed) {
-            if (nb > 0) {
-                LOG_DEBUG_VERBOSE_PACKET("Bytes received: ", (char *)buf_msg, nb);
-
-            } else {
-                LOG_DEBUG_ERROR("Unexpected reading serial port!");
-            }
+        if (nb > start) {
+            LOG_DEBUG_VERBOSE_PACKET("Bytes received: ", (char *)buf_msg, nb);
 
         } else {
             LOG_DEBUG_ERROR("Timeout reading serial port!");
@@ -582,4 +971,3 @@ uint8_t S8_UART::serial_read_bytes(uint8_t max_bytes, uint32_t timeout_ms) {
 
     return nb;
 }
-
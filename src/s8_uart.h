@@ -51,8 +51,10 @@
 #ifndef _S8_UART_H
     #define _S8_UART_H
 
-    #include "Arduino.h"
     #include "utils.h"
+    #include "s8_registers.h"
+    #include "s8_transport.h"
+    #include "s8_cache.h"
 
 
     #define S8_BAUDRATE 9600         // Device to S8 Serial baudrate (should not be changed)
@@ -61,32 +63,36 @@
 
     #define S8_LEN_FIRMVER  10       // Length of software version
 
+    #define S8_PROBE_TIMEOUT  100ul  // Timeout in milliseconds to detect the sensor (a response takes about 25 ms at 9600 bps)
 
-    // Modbus
-    #define MODBUS_ANY_ADDRESS                  0XFE    // S8 uses any address
-    #define MODBUS_FUNC_READ_HOLDING_REGISTERS  0X03    // Read holding registers (HR)
-    #define MODBUS_FUNC_READ_INPUT_REGISTERS    0x04    // Read input registers (IR)
-    #define MODBUS_FUNC_WRITE_SINGLE_REGISTER   0x06    // Write single register (SR)
 
+    // Status of a non-blocking transaction
+    #define S8_TRANSACTION_IDLE      0   // No transaction
+    #define S8_TRANSACTION_PENDING   1   // Request sent, waiting response
+    #define S8_TRANSACTION_DONE      2   // Valid response received
+    #define S8_TRANSACTION_ERROR     3   // Invalid response
+    #define S8_TRANSACTION_TIMEOUT   4   // No complete response before timeout (or cancelled)
 
-    // Input registers for S8
-	#define MODBUS_IR1             0x0000  // MeterStatus
-	#define MODBUS_IR2             0x0001  // AlarmStatus
-	#define MODBUS_IR3             0x0002  // OutputStatus
-	#define MODBUS_IR4             0x0003  // Space CO2
-	#define MODBUS_IR22            0x0015  // PWM Output
-    #define MODBUS_IR26            0x0019  // Sensor Type ID High
-    #define MODBUS_IR27            0x001A  // Sensor Type ID Low
-    #define MODBUS_IR28            0x001B  // Memory Map version
-    #define MODBUS_IR29            0x001C  // FW version Main.Sub
-    #define MODBUS_IR30            0x001D  // Sensor ID High
-    #define MODBUS_IR31            0x001E  // Sensor ID Low
 
+    // Result of a probe
+    #define S8_PROBE_SILENT          0   // Nothing received (no sensor)
+    #define S8_PROBE_NOISE           1   // Bytes received but no valid response (wiring, baudrate, other device)
+    #define S8_PROBE_FOUND           2   // Valid response of the sensor
 
-    // Holding registers for S8
-    #define MODBUS_HR1             0x0000  // Acknowledgement Register
-    #define MODBUS_HR2             0x0001  // Special Command Register
-	#define MODBUS_HR32            0x001F  // ABC Period
+
+    // Result of applying a configuration value
+    #define S8_CONFIG_ERROR          0   // Communication error or invalid value
+    #define S8_CONFIG_UNCHANGED      1   // Sensor already had the value, nothing written
+    #define S8_CONFIG_WRITTEN        2   // Value written and verified
+
+
+    // Blocks of a register dump
+    #define S8_DUMP_MEASURES         0x01   // IR1-IR4
+    #define S8_DUMP_PWM              0x02   // IR22
+    #define S8_DUMP_IDENTITY         0x04   // IR26-IR31
+    #define S8_DUMP_COMMANDS         0x08   // HR1-HR2
+    #define S8_DUMP_ABC              0x10   // HR32
+    #define S8_DUMP_ALL              0x1F
 
 
     // Meter status
@@ -127,10 +133,59 @@
         int16_t map_version;
     };
 
+    /* Snapshot of all documented registers (S8_UART::dump) */
+    struct S8_dump {
+        uint8_t valid;                                  // Blocks read (S8_DUMP_xxx)
+        uint8_t transactions;                           // Transactions used
+        int16_t meter_status;                           // IR1
+        int16_t alarm_status;                           // IR2
+        int16_t output_status;                          // IR3
+        int16_t co2;                                    // IR4
+        int16_t pwm_output;                             // IR22 (raw, 0x3FFF = 100 %)
+        int32_t sensor_type_id;                         // IR26-IR27
+        int16_t map_version;                            // IR28
+        char firm_version[S8_LEN_FIRMVER + 1];          // IR29
+        int32_t sensor_id;                              // IR30-IR31
+        int16_t ack;                                    // HR1
+        int16_t special_command;                        // HR2
+        int16_t abc_period;                             // HR32
+    };
+
+    /* Counters of the link with the sensor */
+    struct S8_link_stats {
+        uint32_t transactions;              // Finished transactions (valid or not)
+        uint32_t errors;                    // Invalid responses
+        uint32_t timeouts;                  // Transactions without complete response
+        uint32_t resyncs;                   // Transactions with bytes discarded while waiting the response
+        uint32_t discarded_bytes;           // Stale bytes before a request or garbage before a response
+        uint32_t last_latency_us;           // Time from request to end of last transaction
+        uint32_t max_latency_us;
+        uint64_t total_latency_us;
+    };
+
+
     class S8_UART
     {
         public:
+        #ifndef S8_HOST
             S8_UART(Stream &serial);                                                // Initialize
+        #endif
+            S8_UART(S8_transport &transport);                                       // Initialize with a transport backend
+            virtual ~S8_UART() {}
+
+            /* Presence of the sensor */
+            uint8_t probe(uint32_t timeout_ms = S8_PROBE_TIMEOUT);                   // Check if a sensor answers (returns S8_PROBE_xxx)
+            static void probe_all(S8_UART *sensors[], uint8_t count, uint8_t results[],
+                                  uint32_t timeout_ms = S8_PROBE_TIMEOUT);          // Probe several sensors in parallel (results in S8_PROBE_xxx)
+
+            /* Timeout of the transactions */
+            void set_timeout(uint32_t timeout_ms) { timeout = timeout_ms; }         // Default S8_TIMEOUT
+            uint32_t get_timeout() { return timeout; }
+
+            /* Transmit mode of the requests */
+            void set_tx_flush(bool flush) { tx_flush = flush; }                     // true (default): wait until the request is sent, false: queue it
+                                                                                    // and listen at once (not for half-duplex lines that need the wait)
+            bool tx_done() { return transport->tx_done(); }                         // Last request completely sent
 
             /* Information about the sensor */
             void get_firmware_version(char firmwver[]);                             // Get firmware version
@@ -145,6 +200,7 @@
             /* Automatic calibration */
             int16_t get_ABC_period();                                               // Get ABC period in hours
             bool set_ABC_period(int16_t period);                                    // Set ABC period (4 - 4800 hours, 0 to disable)
+            uint8_t apply_ABC_period(int16_t period);                               // Set ABC period only if it is different and verify it (returns S8_CONFIG_xxx)
 
             /* Manual calibration */
             bool manual_calibration();                                              // Start a manual calibration (it clears acknowledgement flags and it calls to
@@ -161,17 +217,160 @@
             /* To execute special commands (ex: manual calibration) */
             bool send_special_command(int16_t command);                             // Send special command
 
+            /* Diagnostics */
+            uint8_t dump(S8_dump &dump);                                            // Read all documented registers in 5 transactions (returns S8_DUMP_xxx read)
 
-        private:
-            Stream* mySerial;                                                             // Serial communication with the sensor
+            /* Counters of transactions and latency */
+            const S8_link_stats &link_stats() { return stats; }
+            void reset_link_stats();
+
+            /* Cache of registers (opt-in, NULL to disable) */
+            void set_cache(S8_cache *cache) { this->cache = cache; }
+
+            /* Non-blocking transactions (send a request, then call poll_transaction until it is not pending) */
+            bool request_read(uint8_t func, uint16_t reg, uint8_t words);           // Send request to read consecutive registers
+            bool request_write(uint16_t reg, uint16_t value);                       // Send request to write a holding register
+            uint8_t poll_transaction();                                             // Process received bytes without blocking (returns S8_TRANSACTION_xxx)
+            void cancel_transaction(uint8_t status = S8_TRANSACTION_TIMEOUT);      // Abort pending transaction (ex: deadline reached, port closed)
+            uint8_t wait_transaction();                                             // Block until pending transaction finishes (sleeps in the transport)
+            uint8_t discard_input();                                                // Discard bytes received outside a transaction (returns number of bytes)
+            uint8_t transaction_status() { return tr_status; }                      // Status of last transaction
+            const uint8_t *response_data() { return &buf_msg[3]; }                  // Data of last read (big endian words)
+
+            template <class REG>
+            bool request_read() { return request_read(REG::func, REG::addr, REG::words); }
+
+            template <class REG>
+            typename REG::value_type response_value() { return REG::decode(response_data()); }
+
+
+        protected:
+        #ifndef S8_HOST
+            S8_stream_transport stream_transport;                                         // Backend used for a Stream
+        #endif
+            S8_transport* transport;                                                      // Serial communication with the sensor
             uint8_t buf_msg[S8_LEN_BUF_MSG];                                              // Buffer for communication messages with the sensor
+            bool tx_flush;                                                                // Wait until request is sent
 
-            void serial_write_bytes(uint8_t size);                                        // Send bytes to sensor
-            uint8_t serial_read_bytes(uint8_t max_bytes, uint32_t timeout_seconds);  // Read received bytes from sensor
+            virtual void serial_write_bytes(uint8_t size);                                // Send bytes to sensor
+            virtual uint8_t serial_read_bytes(uint8_t nb, uint8_t max_bytes, uint32_t timeout_ms);    // Read received bytes from sensor (after nb bytes in buffer)
+            bool build_cmd(uint8_t func, uint16_t reg, uint16_t value);                   // Build request in buf_msg
+
+        private:
+            S8_cache* cache;                                                              // Cache of registers (NULL = disabled)
+            uint32_t timeout;                                                             // Timeout for communication in milliseconds
+            uint8_t buf_req[8];                                                           // Last request sent
+            uint8_t tr_status;                                                            // Status of the non-blocking transaction
+            uint8_t tr_func;                                                              // Function of the request
+            uint8_t tr_expected;                                                          // Expected length of the response
+            uint8_t tr_received;                                                          // Bytes received
+            uint32_t tr_discarded;                                                        // Bytes discarded before the response (noise)
+            uint32_t tr_start;                                                            // Time when request was sent
+            uint32_t tr_start_us;                                                         // Time when request was sent (microseconds)
+            S8_link_stats stats;                                                          // Counters of the link
+
+            void count_transaction(uint8_t status, uint32_t start_us);                    // Update counters of the link
+
+            uint8_t drain();                                                              // Discard received bytes (returns number of bytes)
             bool valid_response(uint8_t func, uint8_t nb);                                // Check if response is valid according to sent command
             bool valid_response_len(uint8_t func, uint8_t nb, uint8_t len);               // Check if response is valid according to sent command and checking expected total length
+            uint8_t match_frame(uint8_t *frame, uint8_t avail, uint8_t len);        // Check if bytes can be the start of the response to buf_req
+            bool resync(uint8_t &nb, uint8_t len);                                        // Discard bytes before the response (true if complete)
+            uint8_t check_frame(uint8_t nb, uint8_t len);                                 // Status of a complete response (S8_TRANSACTION_xxx)
+            uint8_t receive_frame(uint8_t len);                                           // Wait response of len bytes (returns S8_TRANSACTION_xxx)
             void send_cmd(uint8_t func, uint16_t reg, uint16_t value);                    // Send command
+            bool read_registers(uint8_t func, uint16_t reg, uint8_t words);               // Read consecutive registers (data starts at buf_msg[3])
+            bool write_register(uint16_t reg, uint16_t value);                            // Write a holding register and check the echo
+
+            /* Read a register (or block) described in s8_registers.h */
+            template <class REG>
+            bool read_register(typename REG::value_type &value) {
+                static_assert(5 + REG::words * 2 <= S8_LEN_BUF_MSG, "Response does not fit in the buffer");
+                int32_t cached;
+
+                if (cache != NULL && cache->get(REG::func, REG::addr, cached)) {
+                    value = cached;
+                    return true;
+                }
+
+                bool result = read_registers(REG::func, REG::addr, REG::words);
+                if (result) {
+                    value = REG::decode(&buf_msg[3]);
+                    if (cache != NULL) {
+                        cache->put(REG::func, REG::addr, value);
+                    }
+                }
+                return result;
+            }
 
     };
 
+
+    #ifndef S8_HOST
+
+    /*
+        S8_UART bound to a concrete serial class (ex: S8_UART_T<HardwareSerial>, S8_UART_T<SoftwareSerial>, S8_UART_T<UART>)
+
+        The byte level calls of the blocking transactions (write, flush, and available and read in the receive loop)
+        are qualified with the serial class, so they are resolved at compile time and can be inlined instead of
+        going through the virtual functions of Stream for every byte. serial_write_bytes and serial_read_bytes are
+        still virtual: one call to send a request and two or three to receive the response (header, then the rest
+        of the frame). drain() before a request and the non-blocking API (request_read, poll_transaction) use the
+        Stream through S8_stream_transport.
+
+        The receive loop polls the serial class, it does not sleep in wait() of a transport, and no transport can
+        be inserted between the driver and the port: capture (S8_capture_transport) and replay (S8_replay_transport)
+        need S8_UART with a transport. Use S8_UART for a generic Stream.
+    */
+    template <class TSerial>
+    class S8_UART_T : public S8_UART
+    {
+        public:
+            S8_UART_T(TSerial &serial) : S8_UART(serial), port(&serial) {}          // Initialize
+
+        protected:
+            TSerial* port;
+
+            TSerial* serial() { return port; }
+
+            /* Send bytes to sensor */
+            void serial_write_bytes(uint8_t size) override {
+                LOG_DEBUG_VERBOSE_PACKET("Bytes to send: ", (char *)buf_msg, size);
+
+                serial()->TSerial::write(buf_msg, size);
+                if (tx_flush) {
+                    serial()->TSerial::flush();
+                }
+            }
+
+            /* Read answer of sensor (until max_bytes are in the buffer or timeout) */
+            uint8_t serial_read_bytes(uint8_t nb, uint8_t max_bytes, uint32_t timeout_ms) override {
+                uint32_t start_t = millis();
+                uint8_t start = nb;
+
+                if (max_bytes > nb && max_bytes <= S8_LEN_BUF_MSG && timeout_ms > 0) {
+
+                    while (nb < max_bytes && (millis() - start_t) <= timeout_ms) {
+                        while (nb < max_bytes && serial()->TSerial::available() > 0) {
+                            buf_msg[nb++] = serial()->TSerial::read();
+                        }
+                    }
+
+                    if (nb > start) {
+                        LOG_DEBUG_VERBOSE_PACKET("Bytes received: ", (char *)buf_msg, nb);
+
+                    } else {
+                        LOG_DEBUG_ERROR("Timeout reading serial port!");
+                    }
+
+                } else {
+                    LOG_DEBUG_ERROR("Invalid parameters!");
+                }
+
+                return nb;
+            }
+    };
+
+    #endif
+
 #endif
@@ -0,0 +1,213 @@
+/***************************************************************************************************************************
+
+	SenseAir S8 Text Writer
+
+	Copyright (c) 2021 Josep Comas
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+	SOFTWARE.
+
+***************************************************************************************************************************/
+
+
+
+#include "s8_writer.h"
+
+
+S8_writer::S8_writer(char *buf, size_t size) {
+    this->buf = buf;
+    this->size = size;
+    out = NULL;
+    clear();
+    if (size > 0) {
+        buf[0] = '\0';
+    }
+}
+
+
+#ifndef S8_HOST
+
+S8_writer::S8_writer(Print &out, char *buf, size_t size) : S8_writer(buf, size) {
+    this->out = &out;
+}
+
+#else
+
+S8_writer::S8_writer(FILE *out, char *buf, size_t size) : S8_writer(buf, size) {
+    this->out = out;
+}
+
+#endif
+
+
+/* Send buffered text to the output */
+void S8_writer::flush() {
+
+    if (out != NULL && len > 0) {
+    #ifndef S8_HOST
+        out->write((const uint8_t *)buf, len);
+    #else
+        fwrite(buf, 1, len, out);
+    #endif
+        total += len;
+        len = 0;
+        buf[0] = '\0';
+    }
+}
+
+
+void S8_writer::put(char c) {
+
+    if (len + 1 >= size) {      // Keep space for the terminator
+        flush();
+        if (len + 1 >= size) {
+            overflowed = true;
+            return;
+        }
+    }
+
+    buf[len++] = c;
+    buf[len] = '\0';
+}
+
+
+void S8_writer::put(const char *str) {
+    size_t n = strlen(str);
+
+    while (n > 0) {
+        if (len + 1 >= size) {
+            flush();
+            if (len + 1 >= size) {
+                overflowed = true;
+                return;
+            }
+        }
+
+        size_t chunk = size - 1 - len;
+        if (chunk > n) {
+            chunk = n;
+        }
+        memcpy(&buf[len], str, chunk);
+        len += chunk;
+        str += chunk;
+        n -= chunk;
+    }
+
+    if (size > 0) {
+        buf[len] = '\0';
+    }
+}
+
+
+void S8_writer::put_uint(uint32_t value) {
+    char digits[10];
+    uint8_t n = 0;
+
+    do {
+        digits[n++] = '0' + value % 10;
+        value /= 10;
+    } while (value > 0);
+
+    while (n > 0) {
+        put(digits[--n]);
+    }
+}
+
+
+void S8_writer::put_uint64(uint64_t value) {
+    char digits[20];
+    uint8_t n = 0;
+
+    if (value <= 0xFFFFFFFFul) {
+        put_uint((uint32_t)value);     // Faster on 32 bits cores
+        return;
+    }
+
+    do {
+        digits[n++] = '0' + value % 10;
+        value /= 10;
+    } while (value > 0);
+
+    while (n > 0) {
+        put(digits[--n]);
+    }
+}
+
+
+void S8_writer::put_int(int32_t value) {
+    if (value < 0) {
+        put('-');
+        put_uint(0ul - (uint32_t)value);
+    } else {
+        put_uint((uint32_t)value);
+    }
+}
+
+
+void S8_writer::put_hex(uint32_t value, uint8_t digits) {
+    static const char hex[] = "0123456789ABCDEF";
+
+    while (digits > 0) {
+        digits--;
+        put(hex[(value >> (digits * 4)) & 0x0F]);
+    }
+}
+
+
+void S8_writer::put_fixed(uint64_t value, uint8_t decimals) {
+    uint64_t scale = 1;
+    char digits[19];
+
+    if (decimals > 19) {
+        decimals = 19;
+    }
+
+    for (uint8_t i = 0; i < decimals; i++) {
+        scale *= 10;
+    }
+
+    put_uint64(value / scale);
+
+    if (decimals > 0) {
+        uint64_t fraction = value % scale;
+        put('.');
+        for (uint8_t i = decimals; i > 0; i--) {
+            digits[i - 1] = '0' + fraction % 10;
+            fraction /= 10;
+        }
+        for (uint8_t i = 0; i < decimals; i++) {
+            put(digits[i]);
+        }
+    }
+}
+
+
+void S8_writer::put_escaped(const char *str) {
+    while (*str != '\0') {
+        char c = *str++;
+        if (c == '\\' || c == '"') {
+            put('\\');
+            put(c);
+        } else if (c == '\n') {
+            put('\\');
+            put('n');
+        } else {
+            put(c);
+        }
+    }
+}
@@ -0,0 +1,82 @@
+/***************************************************************************************************************************
+
+	SenseAir S8 Text Writer
+
+	Copyright (c) 2021 Josep Comas
+
+	Permission is hereby granted, free of charge, to any person obtaining a copy
+	of this software and associated documentation files (the "Software"), to deal
+	in the Software without restriction, including without limitation the rights
+	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+	copies of the Software, and to permit persons to whom the Software is
+	furnished to do so, subject to the following conditions:
+
+	The above copyright notice and this permission notice shall be included in all
+	copies or substantial portions of the Software.
+
+	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+	SOFTWARE.
+
+***************************************************************************************************************************/
+
+
+
+#ifndef _S8_WRITER_H
+    #define _S8_WRITER_H
+
+    #include "utils.h"
+
+
+    /*
+        Text output without dynamic allocation and without printf
+
+        It writes into a buffer given by the caller. If an output is given (Print, or FILE on a host), the buffer
+        is only a small window that is sent to the output when it is full, so the total text can be bigger than
+        the buffer. Without output, text that does not fit is discarded and overflow() is true.
+    */
+    class S8_writer
+    {
+        public:
+            S8_writer(char *buf, size_t size);                                      // Write into buf
+        #ifndef S8_HOST
+            S8_writer(Print &out, char *buf, size_t size);                          // Write to out through buf
+        #else
+            S8_writer(FILE *out, char *buf, size_t size);                           // Write to out through buf
+        #endif
+
+            void put(char c);
+            void put(const char *str);
+            void put_int(int32_t value);
+            void put_uint(uint32_t value);
+            void put_uint64(uint64_t value);
+            void put_hex(uint32_t value, uint8_t digits);                           // Fixed number of digits, upper case
+            void put_fixed(uint64_t value, uint8_t decimals);                       // value / 10^decimals (ex: 12345, 3 -> 12.345)
+            void put_escaped(const char *str);                                      // Escape \, " and new line (label values, JSON strings)
+
+            void flush();                                                           // Send buffered text to the output
+            void clear() { len = 0; overflowed = false; total = 0; }                // Discard text
+
+            const char *text() { return buf; }                                      // Text in the buffer (null terminated)
+            size_t length() { return len; }                                         // Bytes in the buffer
+            size_t written() { return total + len; }                                // Bytes written (including sent to the output)
+            bool overflow() { return overflowed; }                                  // Text discarded
+
+        private:
+            char* buf;
+            size_t size;
+            size_t len;
+            size_t total;
+            bool overflowed;
+        #ifndef S8_HOST
+            Print* out;
+        #else
+            FILE* out;
+        #endif
+    };
+
+#endif
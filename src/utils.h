@@ -28,15 +28,24 @@
 #ifndef _JC_UTILS_H
     #define _JC_UTILS_H
 
+    // Without Arduino framework (Linux, ...) the library is built for the host
+    #ifndef ARDUINO
+        #define S8_HOST
+    #endif
+
     // Boards with a second hardware serial port we don't use sofware serial library
-    #if defined ARDUINO_ARCH_SAMD || defined ARDUINO_ARCH_SAM21D || defined ARDUINO_ARCH_ESP32 || defined ARDUINO_SAM_DUE ||  \
+    #if defined S8_HOST || defined ARDUINO_ARCH_SAMD || defined ARDUINO_ARCH_SAM21D || defined ARDUINO_ARCH_ESP32 || defined ARDUINO_SAM_DUE ||  \
         defined ARDUINO_ARCH_APOLLO3 || defined ARDUINO_ARCH_RP2040
         #undef USE_SOFTWARE_SERIAL
     #else
         #define USE_SOFTWARE_SERIAL
     #endif
 
-    #include "Arduino.h"
+    #ifdef S8_HOST
+        #include "s8_host.h"
+    #else
+        #include "Arduino.h"
+    #endif
 
     #ifdef USE_SOFTWARE_SERIAL
         #include <SoftwareSerial.h>